@@ -5,7 +5,20 @@
             "sources" : [
                 "src/GNContext.cpp",
                 "src/GNUtil.cpp",
-                "src/GNConstants.cpp"
+                "src/GNConstants.cpp",
+                "src/GNBulkResolver.cpp",
+                "src/GNReverseSweep.cpp",
+                "src/GNServiceEndpoints.cpp",
+                "src/GNAddressLookup.cpp",
+                "src/GNRecords.cpp",
+                "src/GNEngine.cpp",
+                "src/GNResultRing.cpp",
+                "src/GNMemoryPool.cpp",
+                "src/GNZoneFiles.cpp",
+                "src/GNWarmup.cpp",
+                "src/GNDeadlines.cpp",
+                "src/GNScheduler.cpp",
+                "src/GNDnstap.cpp"
             ],
             "link_settings" : {
                 "libraries" : [
@@ -27,11 +27,87 @@
 
 "use strict";
 
+const net = require("net");
+const os = require("os");
 const getdns = require("bindings")("getdns");
+const ring = require("./ring");
 
 // Export constants directly.
 module.exports = getdns.constants;
 
+// Read the trust anchor and root hint files shared by all contexts again.
+module.exports.reloadZoneFiles = getdns.reloadZoneFiles;
+
+// Yield { query, response } or { query, error } for each query, in completion order.
+// Queries are names or { name, type, extensions } objects, from an iterable or async iterable.
+// At most options.concurrency (default 100) queries are in flight or waiting to be consumed,
+// so submission pauses while the consumer is busy.
+// An aborted options.signal stops submitting and cancels the queries in flight.
+async function * lookupMany(ctx, queries, options) {
+    const concurrency = (options && options.concurrency) || 100;
+    const signal = options && options.signal;
+    const source = queries[Symbol.asyncIterator] ? queries[Symbol.asyncIterator]() : queries[Symbol.iterator]();
+    const pending = new Set();
+    const settled = [];
+    let exhausted = false;
+    let wake = null;
+
+    const submit = (query) => {
+        const extensions = signal ? Object.assign({}, query.extensions, { signal: signal }) : query.extensions || {};
+        const lookup = ctx.lookup(query.name, query.type || getdns.constants.RRTYPE_A, extensions);
+        const transactionId = lookup.transactionId;
+        pending.add(transactionId);
+
+        const settle = (result) => {
+            pending.delete(transactionId);
+            settled.push(result);
+            if (wake) {
+                wake();
+                wake = null;
+            }
+        };
+
+        lookup.then((response) => settle({
+            query: query,
+            response: response,
+        }), (error) => settle({
+            query: query,
+            error: error,
+        }));
+    };
+
+    try {
+        for (;;) {
+            while (!exhausted && !(signal && signal.aborted) && pending.size + settled.length < concurrency) {
+                const next = await source.next();
+                if (next.done) {
+                    exhausted = true;
+                } else {
+                    submit(typeof next.value === "string" ? { name: next.value } : next.value);
+                }
+            }
+
+            if (settled.length === 0) {
+                if (pending.size === 0) {
+                    return;
+                }
+
+                await new Promise((resolve) => {
+                    wake = resolve;
+                });
+            } else {
+                yield settled.shift();
+            }
+        }
+    } finally {
+        // NOTE: stopping early cancels the queries still in flight.
+        pending.forEach((transactionId) => ctx.cancel(transactionId));
+        if (!exhausted && typeof source.return === "function") {
+            await source.return();
+        }
+    }
+}
+
 // Wrap context creation.
 module.exports.createContext = function(options) {
     if (arguments.length > 1) {
@@ -43,10 +119,123 @@ module.exports.createContext = function(options) {
         throw tooManyArgumentsTypeError;
     }
 
-    const ctx = new getdns.Context(options);
+    const ctx = wrapContext(new getdns.Context(options));
+
+    if (options && options.warmup) {
+        ctx.ready = ctx.warmup(options.warmup === true ? {} : options.warmup);
+        // NOTE: failures are reported to whoever awaits ctx.ready.
+        ctx.ready.catch(() => {});
+    }
+
+    return ctx;
+};
+
+// The error of a lookup whose signal was aborted before it started.
+const createAbortedError = function() {
+    return {
+        msg: "Lookup aborted.",
+        code: getdns.constants.CALLBACK_CANCEL,
+    };
+};
+
+// Add the wrappers to a new native context.
+const wrapContext = function(ctx) {
     const oldDestroyFunc = ctx.destroy;
+    const oldCloneFunc = ctx.clone;
     let destroyed = false;
 
+    // Lookups in flight per AbortSignal, with one abort listener per signal.
+    // NOTE: aborting cancels all of them in one native call.
+    const signalGroups = new Map();
+
+    const watchSignal = (signal, transactionId) => {
+        if (!transactionId) {
+            return;
+        }
+        let group = signalGroups.get(signal);
+        if (!group) {
+            group = {
+                ids: new Map(),
+                onAbort: () => {
+                    signalGroups.delete(signal);
+                    ctx.cancelMany(Array.from(group.ids.values()));
+                },
+            };
+            signalGroups.set(signal, group);
+            signal.addEventListener("abort", group.onAbort, { once: true });
+        }
+        group.ids.set(transactionId.toString("hex"), transactionId);
+    };
+
+    const unwatchSignal = (signal, transactionId) => {
+        const group = signalGroups.get(signal);
+        if (!group || !transactionId) {
+            return;
+        }
+        group.ids.delete(transactionId.toString("hex"));
+        if (group.ids.size === 0) {
+            signalGroups.delete(signal);
+            signal.removeEventListener("abort", group.onAbort);
+        }
+    };
+
+    // Take options.signal out of the extensions (or resolveRecords options) at optionsIndex,
+    // and cancel the lookup when it is aborted.
+    const withSignal = function(lookupFunc, optionsIndex) {
+        return function() {
+            const args = Array.prototype.slice.call(arguments);
+            const options = args[optionsIndex];
+            if (!options || typeof options !== "object" || !options.signal) {
+                return lookupFunc.apply(ctx, args);
+            }
+
+            const signal = options.signal;
+            args[optionsIndex] = Object.assign({}, options);
+            delete args[optionsIndex].signal;
+            const callback = typeof args[args.length - 1] === "function" ? args[args.length - 1] : null;
+
+            if (signal.aborted) {
+                const err = createAbortedError();
+                if (callback) {
+                    process.nextTick(callback, err, null, null);
+
+                    return null;
+                }
+                const error = new Error(err.msg);
+                error.code = err.code;
+                const lookup = Promise.reject(error);
+                lookup.transactionId = null;
+
+                return lookup;
+            }
+
+            if (callback) {
+                args[args.length - 1] = function(err, result, transactionId) {
+                    unwatchSignal(signal, transactionId);
+
+                    return callback.apply(this, arguments);
+                };
+                const transactionId = lookupFunc.apply(ctx, args);
+                watchSignal(signal, transactionId);
+
+                return transactionId;
+            }
+
+            const lookup = lookupFunc.apply(ctx, args);
+            const unwatchLookup = () => unwatchSignal(signal, lookup.transactionId);
+            watchSignal(signal, lookup.transactionId);
+            lookup.then(unwatchLookup, unwatchLookup);
+
+            return lookup;
+        };
+    };
+
+    ctx.lookup = withSignal(ctx.lookup, 2);
+    ctx.getAddress = withSignal(ctx.getAddress, 1);
+    ctx.getService = withSignal(ctx.getService, 1);
+    ctx.getHostname = withSignal(ctx.getHostname, 1);
+    ctx.resolveRecords = withSignal(ctx.resolveRecords, 2);
+
     ctx.destroy = function() {
         if (destroyed) {
             return false;
@@ -58,6 +247,21 @@ module.exports.createContext = function(options) {
         return true;
     };
 
+    // Refuse new lookups, wait at most timeout ms for the pending ones and destroy the context.
+    // Resolves with { pending, completed, cancelled, elapsed }.
+    const oldDrainFunc = ctx.drain;
+    ctx.drain = function(timeout) {
+        if (destroyed) {
+            return Promise.reject(new Error("Context is already destroyed."));
+        }
+
+        return new Promise((resolve) => {
+            // NOTE: throws for a bad timeout, which rejects.
+            oldDrainFunc.call(ctx, timeout, (err, result) => resolve(result));
+            destroyed = true;
+        });
+    };
+
     // Add the wrappers for more consistent getdns API.
     ctx.general = function() {
         return ctx.lookup.apply(ctx, arguments);
@@ -75,5 +279,718 @@ module.exports.createContext = function(options) {
         return ctx.getHostname.apply(ctx, arguments);
     };
 
+    ctx.serviceEndpoints = function() {
+        return ctx.getServiceEndpoints.apply(ctx, arguments);
+    };
+
+    ctx.lookupMany = function(queries, options) {
+        return lookupMany(ctx, queries, options);
+    };
+
+    // Resolve with { queries, succeeded, failed, elapsed } once the upstream connections are open.
+    const oldWarmupFunc = ctx.warmup;
+    ctx.warmup = function(options, callback) {
+        if (typeof options === "function") {
+            callback = options;
+            options = {};
+        }
+        if (typeof callback === "function") {
+            return oldWarmupFunc.call(ctx, options || {}, callback);
+        }
+
+        return new Promise((resolve, reject) => {
+            oldWarmupFunc.call(ctx, options || {}, (err, result) => {
+                if (err) {
+                    const error = new Error(err.msg);
+                    error.code = err.code;
+                    error.result = result;
+
+                    return reject(error);
+                }
+
+                resolve(result);
+            });
+        });
+    };
+
+    ctx.clone = function(options) {
+        return wrapContext(oldCloneFunc.call(ctx, options));
+    };
+
     return ctx;
 };
+
+// Map a lookupAddresses error to a dns.lookup() compatible error.
+// Names without (secure) addresses are not found, other failures are temporary.
+const createLookupError = function(hostname, err) {
+    const isNotFound = err.code === getdns.constants.RESPSTATUS_NO_NAME
+        || err.code === getdns.constants.RESPSTATUS_NO_SECURE_ANSWERS
+        || err.code === getdns.constants.RESPSTATUS_ALL_BOGUS_ANSWERS;
+    const code = isNotFound ? "ENOTFOUND" : "EAI_AGAIN";
+    const error = new Error("getaddrinfo " + code + " " + hostname);
+    error.code = code;
+    error.syscall = "getaddrinfo";
+    error.hostname = hostname;
+
+    return error;
+};
+
+const orderAddresses = function(entries, order) {
+    if (order === "ipv4first" || order === "ipv6first") {
+        const first = order === "ipv4first" ? 4 : 6;
+
+        return entries.filter((entry) => entry.family === first)
+            .concat(entries.filter((entry) => entry.family !== first));
+    }
+
+    // NOTE: "verbatim" keeps the RFC 6724 order from lookupAddresses.
+    return entries;
+};
+
+// Create a function with the dns.lookup() signature, for the lookup option of net.connect(), http.Agent, tls.connect(), etc.
+module.exports.createLookup = function(options) {
+    const ctx = module.exports.createContext(options);
+
+    const lookup = function(hostname, lookupOptions, callback) {
+        if (typeof lookupOptions === "function") {
+            callback = lookupOptions;
+            lookupOptions = {};
+        } else if (typeof lookupOptions === "number") {
+            lookupOptions = {
+                family: lookupOptions,
+            };
+        } else if (!lookupOptions) {
+            lookupOptions = {};
+        }
+
+        let family = 0;
+        if (lookupOptions.family === 4 || lookupOptions.family === "IPv4") {
+            family = 4;
+        } else if (lookupOptions.family === 6 || lookupOptions.family === "IPv6") {
+            family = 6;
+        }
+        const all = lookupOptions.all === true;
+        const order = lookupOptions.order || (lookupOptions.verbatim === false ? "ipv4first" : "verbatim");
+
+        const deliver = (err, entries) => {
+            if (err) {
+                return callback(createLookupError(hostname, err));
+            }
+
+            const ordered = orderAddresses(entries.map((entry) => ({
+                address: entry.address,
+                family: entry.family,
+            })), order);
+
+            if (all) {
+                return callback(null, ordered);
+            }
+
+            return callback(null, ordered[0].address, ordered[0].family);
+        };
+
+        if (!hostname) {
+            // NOTE: same as dns.lookup() for empty hostnames.
+            return process.nextTick(callback, null, all ? [] : null, family === 6 ? 6 : 4);
+        }
+
+        const ipFamily = net.isIP(hostname);
+        if (ipFamily) {
+            return process.nextTick(deliver, null, [
+                {
+                    address: hostname,
+                    family: ipFamily,
+                },
+            ]);
+        }
+
+        // NOTE: cached answers are returned synchronously, but dns.lookup() callbacks are always asynchronous.
+        let isSync = true;
+        ctx.lookupAddresses(hostname, family, (err, entries) => {
+            if (isSync) {
+                return process.nextTick(deliver, err, entries);
+            }
+
+            return deliver(err, entries);
+        });
+        isSync = false;
+    };
+
+    lookup.context = ctx;
+
+    return lookup;
+};
+
+// Map a resolveRecords error to a node dns compatible error.
+const createResolverError = function(syscall, hostname, err) {
+    let code = err.dnsCode;
+    if (!code) {
+        code = err.code === getdns.constants.RETURN_BAD_DOMAIN_NAME ? "EBADNAME" : "EINVAL";
+    }
+    const error = new Error(syscall + " " + code + " " + hostname);
+    error.code = code;
+    error.errno = err.code;
+    error.syscall = syscall;
+    error.hostname = hostname;
+
+    return error;
+};
+
+// Parse a server as accepted by dns.setServers(), such as "8.8.8.8", "8.8.8.8:5353", "::1" or "[::1]:5353".
+const parseServer = function(server) {
+    let address = server;
+    let port = 53;
+    const bracketed = /^\[([^\]]+)\](?::(\d+))?$/.exec(server);
+    const withPort = /^([^:]+):(\d+)$/.exec(server);
+    if (bracketed) {
+        address = bracketed[1];
+        port = bracketed[2] ? parseInt(bracketed[2], 10) : 53;
+    } else if (withPort) {
+        address = withPort[1];
+        port = parseInt(withPort[2], 10);
+    }
+
+    if (!net.isIP(address) || port < 1 || port > 65535) {
+        const invalidServerTypeError = new TypeError("Invalid IP address: " + server);
+        invalidServerTypeError.code = getdns.constants.RETURN_INVALID_PARAMETER;
+
+        throw invalidServerTypeError;
+    }
+
+    return {
+        address: address,
+        port: port,
+    };
+};
+
+const RESOLVER_TYPES = {
+    A: "RRTYPE_A",
+    AAAA: "RRTYPE_AAAA",
+    CNAME: "RRTYPE_CNAME",
+    MX: "RRTYPE_MX",
+    NS: "RRTYPE_NS",
+    PTR: "RRTYPE_PTR",
+    SOA: "RRTYPE_SOA",
+    SRV: "RRTYPE_SRV",
+    TXT: "RRTYPE_TXT",
+};
+
+// A promise based resolver with the API of node's dns.promises.Resolver.
+// Records are shaped natively by ctx.resolveRecords(), and the context options (such as dns_transport_list) apply as usual.
+class Resolver {
+    constructor(options) {
+        // NOTE: the node.js "tries" option has no getdns equivalent, retries are up to the context.
+        const contextOptions = Object.assign({
+            resolution_type: getdns.constants.RESOLUTION_STUB,
+        }, options);
+        delete contextOptions.tries;
+        if (contextOptions.timeout === -1) {
+            delete contextOptions.timeout;
+        }
+
+        this.context = module.exports.createContext(contextOptions);
+        this._servers = [];
+        this._pending = new Set();
+    }
+
+    _query(syscall, hostname, rrtype, options) {
+        const type = RESOLVER_TYPES[rrtype];
+        if (!type) {
+            return Promise.reject(new TypeError("Unknown rrtype: " + rrtype));
+        }
+
+        const query = this.context.resolveRecords(hostname, getdns.constants[type], options || {});
+        const transactionId = query.transactionId;
+        if (transactionId) {
+            this._pending.add(transactionId);
+        }
+
+        return query.then((records) => {
+            this._pending.delete(transactionId);
+
+            return records;
+        }, (err) => {
+            this._pending.delete(transactionId);
+
+            throw createResolverError(syscall, hostname, err);
+        });
+    }
+
+    // Cancel all outstanding queries, which reject with ECANCELLED.
+    cancel() {
+        this._pending.forEach((transactionId) => this.context.cancel(transactionId));
+        this._pending.clear();
+    }
+
+    getServers() {
+        return this._servers.map((server) => {
+            if (server.port === 53) {
+                return server.address;
+            }
+
+            return (net.isIPv6(server.address) ? "[" + server.address + "]" : server.address) + ":" + server.port;
+        });
+    }
+
+    setServers(servers) {
+        const parsed = servers.map(parseServer);
+
+        this.context.upstream_recursive_servers = parsed.map((server) => {
+            if (server.port === 53) {
+                return server.address;
+            }
+
+            return [
+                server.address,
+                server.port,
+            ];
+        });
+        this._servers = parsed;
+    }
+
+    resolve(hostname, rrtype) {
+        const type = rrtype || "A";
+
+        return this._query("query" + type.charAt(0) + type.slice(1).toLowerCase(), hostname, type);
+    }
+
+    resolve4(hostname, options) {
+        return this._query("queryA", hostname, "A", options && {
+            ttl: options.ttl === true,
+        });
+    }
+
+    resolve6(hostname, options) {
+        return this._query("queryAaaa", hostname, "AAAA", options && {
+            ttl: options.ttl === true,
+        });
+    }
+
+    resolveCname(hostname) {
+        return this._query("queryCname", hostname, "CNAME");
+    }
+
+    resolveMx(hostname) {
+        return this._query("queryMx", hostname, "MX");
+    }
+
+    resolveNs(hostname) {
+        return this._query("queryNs", hostname, "NS");
+    }
+
+    resolvePtr(hostname) {
+        return this._query("queryPtr", hostname, "PTR");
+    }
+
+    resolveSoa(hostname) {
+        return this._query("querySoa", hostname, "SOA");
+    }
+
+    resolveSrv(hostname) {
+        return this._query("querySrv", hostname, "SRV");
+    }
+
+    resolveTxt(hostname) {
+        return this._query("queryTxt", hostname, "TXT");
+    }
+
+    reverse(ip) {
+        if (!net.isIP(ip)) {
+            return Promise.reject(createResolverError("getHostByAddr", ip, {
+                dnsCode: "EINVAL",
+                code: getdns.constants.RETURN_INVALID_PARAMETER,
+            }));
+        }
+
+        return this._query("getHostByAddr", ip, "PTR");
+    }
+
+    // Destroy the underlying context, not part of the node.js API.
+    destroy() {
+        return this.context.destroy();
+    }
+}
+
+module.exports.Resolver = Resolver;
+
+// Hash a name into a 64 bit key, case insensitive and ignoring a trailing dot.
+const hashName = function(name) {
+    const normalized = String(name).toLowerCase().replace(/\.$/, "");
+    let high = 0;
+    let low = 0;
+    for (let i = 0; i < normalized.length; i++) {
+        const code = normalized.charCodeAt(i);
+        high = (high * 131 + code) % 4294967291;
+        low = (low * 257 + code) % 4294967279;
+    }
+
+    // Mix the bits, so similar names land on different contexts.
+    let key = BigInt.asUintN(64, (BigInt(high) * 4294967296n + BigInt(low)) * 0xbf58476d1ce4e5b9n);
+    key = BigInt.asUintN(64, (key / 4294967296n + key) * 0x94d049bb133111ebn);
+
+    return key;
+};
+
+// Jump consistent hash (Lamping and Veach), so resizing a pool moves as few names as possible.
+const jumpHash = function(key, buckets) {
+    let bucket = -1;
+    let next = 0;
+    while (next < buckets) {
+        bucket = next;
+        key = BigInt.asUintN(64, key * 2862933555777941757n + 1n);
+        next = Math.floor((bucket + 1) * (2147483648 / (Number(key / 8589934592n) + 1)));
+    }
+
+    return bucket;
+};
+
+const POOL_METHODS = [
+    "general",
+    "address",
+    "service",
+    "hostname",
+    "lookupTypes",
+    "resolveRecords",
+    "lookupAddresses",
+    "serviceEndpoints",
+];
+
+// Threaded contexts sharing the lookups of an application, each on its own thread and event loop.
+// Lookups are routed by name so each context keeps its own part of the cache warm.
+class ContextPool {
+    constructor(size, options) {
+        if (size === undefined || size === null) {
+            size = os.cpus().length;
+        }
+        if (!Number.isInteger(size) || size < 1) {
+            const sizeTypeError = new TypeError("size");
+            sizeTypeError.code = getdns.constants.RETURN_INVALID_PARAMETER;
+
+            throw sizeTypeError;
+        }
+
+        const contextOptions = Object.assign({}, options, {
+            threaded: true,
+        });
+        this.contexts = [];
+        this.shards = [];
+        for (let i = 0; i < size; i++) {
+            this.contexts.push(module.exports.createContext(contextOptions));
+            this.shards.push({
+                queries: 0,
+                inFlight: 0,
+                completed: 0,
+                errors: 0,
+            });
+        }
+    }
+
+    // Index of the context for a name, or for an address given to hostname().
+    shardFor(key) {
+        if (typeof key === "object" && key !== null) {
+            key = Buffer.isBuffer(key.address_data) ? key.address_data.toString("hex") : JSON.stringify(key);
+        }
+
+        return jumpHash(hashName(key), this.contexts.length);
+    }
+
+    // The context serving a name, for example to cancel one of its lookups;
+    // transaction ids are only unique per context.
+    contextFor(key) {
+        return this.contexts[this.shardFor(key)];
+    }
+
+    _route(method, key, args) {
+        const index = this.shardFor(key);
+        const shard = this.shards[index];
+        const ctx = this.contexts[index];
+        const done = (err) => {
+            shard.inFlight--;
+            shard.completed++;
+            if (err) {
+                shard.errors++;
+            }
+        };
+
+        shard.queries++;
+        shard.inFlight++;
+        const last = args.length - 1;
+        if (last >= 0 && typeof args[last] === "function") {
+            const callback = args[last];
+            args[last] = function(err) {
+                done(err);
+
+                return callback.apply(this, arguments);
+            };
+        }
+
+        let result;
+        try {
+            result = ctx[method].apply(ctx, [key].concat(args));
+        } catch (err) {
+            done(err);
+
+            throw err;
+        }
+
+        if (result && typeof result.then === "function" && typeof args[last] !== "function") {
+            result.then(() => done(null), (err) => done(err));
+        }
+
+        return result;
+    }
+
+    // Counters summed over all contexts, with the per context counters in shards.
+    stats() {
+        const total = {
+            size: this.contexts.length,
+            queries: 0,
+            inFlight: 0,
+            completed: 0,
+            errors: 0,
+            shards: this.shards.map((shard) => Object.assign({}, shard)),
+        };
+        this.shards.forEach((shard) => {
+            total.queries += shard.queries;
+            total.inFlight += shard.inFlight;
+            total.completed += shard.completed;
+            total.errors += shard.errors;
+        });
+
+        return total;
+    }
+
+    destroy() {
+        return this.contexts.map((ctx) => ctx.destroy()).every((destroyed) => destroyed);
+    }
+}
+
+POOL_METHODS.forEach((method) => {
+    ContextPool.prototype[method] = function(key, ...args) {
+        return this._route(method, key, args);
+    };
+});
+
+ContextPool.prototype.lookup = ContextPool.prototype.general;
+
+module.exports.ContextPool = ContextPool;
+
+const elapsedSince = function(start) {
+    const elapsed = process.hrtime(start);
+
+    return elapsed[0] * 1e3 + elapsed[1] / 1e6;
+};
+
+const SELECTOR_OPTIONS = [
+    "hedge",
+    "minHedgeDelay",
+    "maxHedgeDelay",
+    "exploration",
+];
+
+// Stub lookups through one context per upstream, sent to the upstream with the lowest expected latency.
+// Latency is estimated per upstream as in TCP (RFC 6298): a moving average and its mean deviation.
+// With hedge, a lookup still unanswered after the expected latency plus four deviations is raced
+// against the next fastest upstream, and the slower lookup is cancelled.
+class UpstreamSelector {
+    constructor(upstreams, options) {
+        if (!Array.isArray(upstreams) || upstreams.length === 0) {
+            const upstreamsTypeError = new TypeError("upstreams");
+            upstreamsTypeError.code = getdns.constants.RETURN_INVALID_PARAMETER;
+
+            throw upstreamsTypeError;
+        }
+
+        const settings = Object.assign({}, options);
+        this.hedge = Boolean(settings.hedge);
+        this.minHedgeDelay = settings.minHedgeDelay || 10;
+        this.maxHedgeDelay = settings.maxHedgeDelay || 1000;
+        this.exploration = settings.exploration === undefined ? 0.05 : settings.exploration;
+        SELECTOR_OPTIONS.forEach((name) => delete settings[name]);
+
+        this.upstreams = upstreams.map((entry) => {
+            // NOTE: { upstream, rate_limit } entries give an upstream its own rate limit, or none with null.
+            const isEntryObject = entry !== null && typeof entry === "object" && !Array.isArray(entry);
+            const upstream = isEntryObject ? entry.upstream : entry;
+            const contextSettings = Object.assign({}, settings);
+            if (isEntryObject && entry.rate_limit !== undefined) {
+                contextSettings.rate_limit = entry.rate_limit;
+            }
+            if (contextSettings.rate_limit === null) {
+                delete contextSettings.rate_limit;
+            }
+
+            return {
+                upstream: upstream,
+                context: module.exports.createContext(Object.assign(contextSettings, {
+                    resolution_type: getdns.constants.RESOLUTION_STUB,
+                    upstream_recursive_servers: [
+                        upstream,
+                    ],
+                })),
+                latency: null,
+                deviation: 0,
+                queries: 0,
+                errors: 0,
+                hedges: 0,
+                wins: 0,
+                limited: 0,
+            };
+        });
+    }
+
+    // Fastest first, untried upstreams before all others. Now and then another upstream goes
+    // first, so the estimate of an upstream that was slow for a while gets updated.
+    _ranked() {
+        const ranked = this.upstreams.slice().sort((a, b) => (a.latency || 0) - (b.latency || 0));
+        if (ranked.length > 1 && Math.random() < this.exploration) {
+            const other = 1 + Math.floor(Math.random() * (ranked.length - 1));
+            const first = ranked[0];
+            ranked[0] = ranked[other];
+            ranked[other] = first;
+        }
+
+        return ranked;
+    }
+
+    _hedgeDelay(state) {
+        if (state.latency === null) {
+            return this.maxHedgeDelay;
+        }
+
+        return Math.min(this.maxHedgeDelay, Math.max(this.minHedgeDelay, state.latency + 4 * state.deviation));
+    }
+
+    _sample(state, elapsed) {
+        if (state.latency === null) {
+            state.latency = elapsed;
+            state.deviation = elapsed / 2;
+        } else {
+            state.deviation = 0.75 * state.deviation + 0.25 * Math.abs(state.latency - elapsed);
+            state.latency = 0.875 * state.latency + 0.125 * elapsed;
+        }
+    }
+
+    _query(method, args) {
+        return new Promise((resolve, reject) => {
+            const ranked = this._ranked();
+            const attempts = [];
+            let settled = false;
+            let failures = 0;
+            let timer = null;
+
+            const launch = () => {
+                const state = ranked[attempts.length];
+                const start = process.hrtime();
+                state.queries++;
+                const lookup = state.context[method].apply(state.context, args);
+                const attempt = {
+                    state: state,
+                    start: start,
+                    transactionId: lookup.transactionId,
+                    done: false,
+                };
+                attempts.push(attempt);
+
+                lookup.then((result) => {
+                    attempt.done = true;
+                    this._sample(state, elapsedSince(start));
+                    if (settled) {
+                        return;
+                    }
+                    settled = true;
+                    clearTimeout(timer);
+                    state.wins++;
+                    attempts.forEach((other) => {
+                        if (!other.done) {
+                            // The loser took at least this long, which is all there is to learn from it.
+                            this._sample(other.state, elapsedSince(other.start));
+                            other.state.context.cancel(other.transactionId);
+                        }
+                    });
+                    resolve(result);
+                }, (err) => {
+                    attempt.done = true;
+                    if (settled) {
+                        // NOTE: the slower lookup of a race, cancelled.
+                        return;
+                    }
+                    if (err.code === getdns.constants.RETURN_RATE_LIMITED) {
+                        // NOTE: says nothing about the upstream itself, so no latency sample.
+                        state.limited++;
+                    } else {
+                        state.errors++;
+                        this._sample(state, Math.max(elapsedSince(start), this.maxHedgeDelay));
+                    }
+                    failures++;
+                    if (failures < attempts.length) {
+                        return;
+                    }
+                    clearTimeout(timer);
+                    if (attempts.length < ranked.length) {
+                        // Fail over right away.
+                        launch();
+                    } else {
+                        settled = true;
+                        reject(err);
+                    }
+                });
+
+                if (this.hedge && attempts.length === 1 && ranked.length > 1) {
+                    timer = setTimeout(() => {
+                        if (!settled && attempts.length === 1) {
+                            ranked[1].hedges++;
+                            launch();
+                        }
+                    }, this._hedgeDelay(state));
+                }
+            };
+
+            launch();
+        });
+    }
+
+    // { upstream, latency, deviation, queries, errors, hedges, wins, limited } per upstream, latencies in milliseconds.
+    stats() {
+        return this.upstreams.map((state) => ({
+            upstream: state.upstream,
+            latency: state.latency,
+            deviation: state.deviation,
+            queries: state.queries,
+            errors: state.errors,
+            hedges: state.hedges,
+            wins: state.wins,
+            limited: state.limited,
+        }));
+    }
+
+    destroy() {
+        return this.upstreams.map((state) => state.context.destroy()).every((destroyed) => destroyed);
+    }
+}
+
+[
+    "general",
+    "address",
+    "hostname",
+    "service",
+    "resolveRecords",
+].forEach((method) => {
+    UpstreamSelector.prototype[method] = function(...args) {
+        const callback = typeof args[args.length - 1] === "function" ? args.pop() : null;
+        const lookup = this._query(method, args);
+        if (!callback) {
+            return lookup;
+        }
+
+        lookup.then((result) => callback(null, result), (err) => callback(err, null));
+    };
+});
+
+UpstreamSelector.prototype.lookup = UpstreamSelector.prototype.general;
+
+module.exports.UpstreamSelector = UpstreamSelector;
+
+// SharedArrayBuffer rings for ctx.attachRing(), see ring.js.
+module.exports.createRing = ring.createRing;
+module.exports.RingClient = ring.RingClient;
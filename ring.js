@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+"use strict";
+
+// Worker side of the SharedArrayBuffer rings served by ctx.attachRing().
+// Plain JavaScript without the native addon, so it can be required from worker threads.
+// See GNResultRing.h for the layout.
+
+const MAGIC = 0x474e5231;
+const HEADER_SIZE = 64;
+const SUBMISSION_HEADER_SIZE = 8;
+const RESULT_HEADER_SIZE = 20;
+const UINT32 = 4294967296;
+
+const H_MAGIC = 0;
+const H_SLOTS = 1;
+const H_SLOT_SIZE = 2;
+const H_SUBMISSION_HEAD = 3;
+const H_SUBMISSION_TAIL = 4;
+const H_RESULT_HEAD = 5;
+const H_RESULT_TAIL = 6;
+const H_DROPPED = 7;
+
+const FLAG_WIRE = 1;
+const FLAG_TRUNCATED = 2;
+
+const isPowerOfTwo = function(value) {
+    while (value > 1 && value % 2 === 0) {
+        value /= 2;
+    }
+
+    return value === 1;
+};
+
+// Counters are free running uint32s stored as int32s.
+const counter = function(header, index) {
+    const value = Atomics.load(header, index);
+
+    return value < 0 ? value + UINT32 : value;
+};
+
+const distance = function(from, to) {
+    return (to - from + UINT32) % UINT32;
+};
+
+const formatIPv6 = function(bytes) {
+    const groups = [];
+    for (let i = 0; i < 16; i += 2) {
+        groups.push(bytes[i] * 256 + bytes[i + 1]);
+    }
+
+    // Compress the longest run of two or more zero groups.
+    let bestStart = -1;
+    let bestLength = 1;
+    for (let i = 0; i < 8;) {
+        let j = i;
+        while (j < 8 && groups[j] === 0) {
+            j++;
+        }
+        if (j - i > bestLength) {
+            bestStart = i;
+            bestLength = j - i;
+        }
+        i = Math.max(j, i + 1);
+    }
+
+    const hex = groups.map((group) => group.toString(16));
+    if (bestStart < 0) {
+        return hex.join(":");
+    }
+
+    return hex.slice(0, bestStart).join(":") + "::" + hex.slice(bestStart + bestLength).join(":");
+};
+
+// Allocate and format a ring for one worker.
+const createRing = function(options) {
+    const slots = (options && options.slots) || 1024;
+    const slotSize = (options && options.slotSize) || 512;
+    if (!Number.isInteger(slots) || slots < 2 || !isPowerOfTwo(slots)) {
+        throw new TypeError("slots must be a power of two");
+    }
+    if (!Number.isInteger(slotSize) || slotSize < 64 || slotSize % 8 !== 0) {
+        throw new TypeError("slotSize must be a multiple of 8, at least 64");
+    }
+
+    const buffer = new SharedArrayBuffer(HEADER_SIZE + 2 * slots * slotSize);
+    const header = new Int32Array(buffer, 0, HEADER_SIZE / 4);
+    header[H_SLOTS] = slots;
+    header[H_SLOT_SIZE] = slotSize;
+    Atomics.store(header, H_MAGIC, MAGIC);
+
+    return buffer;
+};
+
+class RingClient {
+    constructor(buffer) {
+        this.header = new Int32Array(buffer, 0, HEADER_SIZE / 4);
+        if (Atomics.load(this.header, H_MAGIC) !== MAGIC) {
+            throw new TypeError("buffer is not a getdns ring");
+        }
+        this.slots = this.header[H_SLOTS];
+        this.slotSize = this.header[H_SLOT_SIZE];
+        this.submissions = new Uint8Array(buffer, HEADER_SIZE, this.slots * this.slotSize);
+        this.results = new Uint8Array(buffer, HEADER_SIZE + this.slots * this.slotSize, this.slots * this.slotSize);
+        this.view = new DataView(buffer);
+        this.encoder = new TextEncoder();
+        this.nextId = 1;
+    }
+
+    // Queue a lookup, returns its id or -1 when the submission ring is full.
+    submit(name, type) {
+        const head = counter(this.header, H_SUBMISSION_HEAD);
+        const tail = counter(this.header, H_SUBMISSION_TAIL);
+        if (distance(head, tail) >= this.slots) {
+            return -1;
+        }
+
+        const offset = (tail % this.slots) * this.slotSize;
+        const target = this.submissions.subarray(offset + SUBMISSION_HEADER_SIZE, offset + this.slotSize);
+        const written = this.encoder.encodeInto(name, target).written;
+        const id = this.nextId;
+        this.nextId = this.nextId % (UINT32 - 1) + 1;
+        const base = HEADER_SIZE + offset;
+        this.view.setUint32(base, id, true);
+        this.view.setUint16(base + 4, type === undefined ? 1 : type, true);
+        this.view.setUint16(base + 6, written, true);
+        Atomics.store(this.header, H_SUBMISSION_TAIL, (tail + 1) % UINT32);
+
+        return id;
+    }
+
+    // Take the next result, or null when none is ready.
+    poll() {
+        const head = counter(this.header, H_RESULT_HEAD);
+        const tail = counter(this.header, H_RESULT_TAIL);
+        if (head === tail) {
+            return null;
+        }
+
+        const offset = (head % this.slots) * this.slotSize;
+        const base = HEADER_SIZE + this.slots * this.slotSize + offset;
+        const flags = this.view.getUint16(base + 14, true);
+        const length = this.view.getUint32(base + 16, true);
+        const payload = this.results.subarray(offset + RESULT_HEADER_SIZE, offset + RESULT_HEADER_SIZE + length);
+        const result = {
+            id: this.view.getUint32(base, true),
+            status: this.view.getUint32(base + 4, true),
+            ttl: this.view.getUint32(base + 8, true),
+            type: this.view.getUint16(base + 12, true),
+            truncated: flags === FLAG_TRUNCATED || flags === FLAG_WIRE + FLAG_TRUNCATED,
+        };
+        if (flags === FLAG_WIRE || flags === FLAG_WIRE + FLAG_TRUNCATED) {
+            result.wire = payload.slice();
+        } else {
+            result.addresses = [];
+            for (let i = 0; i < length;) {
+                if (payload[i] === 4) {
+                    result.addresses.push(Array.from(payload.subarray(i + 1, i + 5)).join("."));
+                    i += 5;
+                } else {
+                    result.addresses.push(formatIPv6(payload.subarray(i + 1, i + 17)));
+                    i += 17;
+                }
+            }
+        }
+        Atomics.store(this.header, H_RESULT_HEAD, (head + 1) % UINT32);
+
+        return result;
+    }
+
+    // Block until a result is ready or timeout milliseconds pass; returns true when one is ready.
+    wait(timeout) {
+        const tail = Atomics.load(this.header, H_RESULT_TAIL);
+        if (Atomics.load(this.header, H_RESULT_HEAD) !== tail) {
+            return true;
+        }
+
+        return Atomics.wait(this.header, H_RESULT_TAIL, tail, timeout) !== "timed-out";
+    }
+
+    // Number of results dropped because the result ring was full.
+    dropped() {
+        return Atomics.load(this.header, H_DROPPED);
+    }
+}
+
+module.exports.createRing = createRing;
+module.exports.RingClient = RingClient;
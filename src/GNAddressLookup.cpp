@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNAddressLookup.h"
+#include "GNContext.h"
+#include "GNUtil.h"
+
+#include <arpa/inet.h>
+#include <algorithm>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uv.h>
+
+using namespace v8;
+
+// Never cache longer than this, whatever the TTL says.
+static const uint32_t MAX_CACHE_TTL = 300;
+static const size_t MAX_CACHE_ENTRIES = 4096;
+
+// How long the local interface check for usable families is trusted.
+static const uint64_t INTERFACE_CHECK_INTERVAL = 30000;
+
+// Per query user arg
+typedef struct AddressQuery {
+    GNContext* ctx;
+    Nan::Callback* callback;
+    std::string key;
+    int family;
+} AddressQuery;
+
+bool GNAddressLookup::Cache::Get(const std::string& key, uint64_t now, std::vector<Entry>& entries) {
+    std::unordered_map<std::string, Record>::iterator it = records_.find(key);
+    if (it == records_.end()) {
+        return false;
+    }
+    if (it->second.expires <= now) {
+        records_.erase(it);
+        return false;
+    }
+    entries = it->second.entries;
+    // report the remaining TTL
+    uint32_t remaining = (uint32_t) ((it->second.expires - now) / 1000);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        entries[i].ttl = std::min(entries[i].ttl, remaining);
+    }
+    return true;
+}
+
+void GNAddressLookup::Cache::Put(const std::string& key, uint64_t now, const std::vector<Entry>& entries) {
+    uint32_t ttl = MAX_CACHE_TTL;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        ttl = std::min(ttl, entries[i].ttl);
+    }
+    if (ttl == 0 || entries.empty()) {
+        return;
+    }
+    if (records_.size() >= MAX_CACHE_ENTRIES) {
+        // drop expired records first, everything if that is not enough
+        for (std::unordered_map<std::string, Record>::iterator it = records_.begin(); it != records_.end(); ) {
+            if (it->second.expires <= now) {
+                it = records_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (records_.size() >= MAX_CACHE_ENTRIES) {
+            records_.clear();
+        }
+    }
+    Record& record = records_[key];
+    record.expires = now + (uint64_t) ttl * 1000;
+    record.entries = entries;
+}
+
+// RFC 6724 section 2.1 default policy table, most specific prefixes first
+typedef struct Policy {
+    uint8_t prefix[16];
+    int bits;
+    int precedence;
+} Policy;
+
+static const Policy POLICIES[] = {
+    { { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1 }, 128, 50 },         // ::1/128
+    { { 0,0,0,0,0,0,0,0,0,0,0xff,0xff,0,0,0,0 }, 96, 35 },    // ::ffff:0:0/96
+    { { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 }, 96, 1 },           // ::/96
+    { { 0x20,0x01,0,0 }, 32, 5 },                             // 2001::/32
+    { { 0x20,0x02 }, 16, 30 },                                // 2002::/16
+    { { 0x3f,0xfe }, 16, 1 },                                 // 3ffe::/16
+    { { 0xfe,0xc0 }, 10, 1 },                                 // fec0::/10
+    { { 0xfc }, 7, 3 },                                       // fc00::/7
+    { { 0 }, 0, 40 }                                          // ::/0
+};
+
+static bool prefixMatch(const uint8_t* addr, const uint8_t* prefix, int bits) {
+    for (int bit = 0; bit < bits; ++bit) {
+        uint8_t mask = (uint8_t) (0x80 >> (bit % 8));
+        if ((addr[bit / 8] & mask) != (prefix[bit / 8] & mask)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sort key for one destination address
+typedef struct Rank {
+    bool usable;
+    int precedence;
+    int scope;
+} Rank;
+
+// Which families have a non-loopback, non-link-local source address.
+// Destinations of a family without one are unusable (rules 1 and 2).
+static void usableFamilies(bool& ipv4, bool& ipv6) {
+    static uint64_t checked = 0;
+    static bool hasIpv4 = true;
+    static bool hasIpv6 = true;
+    uint64_t now = uv_now(uv_default_loop());
+    if (checked == 0 || now - checked > INTERFACE_CHECK_INTERVAL) {
+        uv_interface_address_t* interfaces = NULL;
+        int count = 0;
+        if (uv_interface_addresses(&interfaces, &count) == 0) {
+            hasIpv4 = false;
+            hasIpv6 = false;
+            for (int i = 0; i < count; ++i) {
+                if (interfaces[i].is_internal) {
+                    continue;
+                }
+                if (interfaces[i].address.address4.sin_family == AF_INET) {
+                    hasIpv4 = true;
+                } else if (interfaces[i].address.address6.sin6_family == AF_INET6) {
+                    const uint8_t* a = interfaces[i].address.address6.sin6_addr.s6_addr;
+                    if (!(a[0] == 0xfe && (a[1] & 0xc0) == 0x80)) {
+                        hasIpv6 = true;
+                    }
+                }
+            }
+            uv_free_interface_addresses(interfaces, count);
+        }
+        checked = now;
+    }
+    ipv4 = hasIpv4;
+    ipv6 = hasIpv6;
+}
+
+static Rank rankAddress(const GNAddressLookup::Entry& entry, bool ipv4, bool ipv6) {
+    Rank rank;
+    uint8_t addr[16];
+    memset(addr, 0, sizeof(addr));
+    if (entry.family == 4) {
+        // compare as an IPv4-mapped address
+        addr[10] = 0xff;
+        addr[11] = 0xff;
+        inet_pton(AF_INET, entry.address.c_str(), addr + 12);
+    } else {
+        inet_pton(AF_INET6, entry.address.c_str(), addr);
+    }
+    rank.usable = entry.family == 4 ? ipv4 : ipv6;
+    rank.precedence = 40;
+    for (size_t i = 0; i < sizeof(POLICIES) / sizeof(Policy); ++i) {
+        if (prefixMatch(addr, POLICIES[i].prefix, POLICIES[i].bits)) {
+            rank.precedence = POLICIES[i].precedence;
+            break;
+        }
+    }
+    // rule 8, smaller scopes first: link-local 2, site-local 5, global 14
+    rank.scope = 14;
+    if (entry.family == 4) {
+        if (addr[12] == 127 || (addr[12] == 169 && addr[13] == 254)) {
+            rank.scope = 2;
+        }
+    } else if (addr[0] == 0xff) {
+        rank.scope = addr[1] & 0x0f;
+    } else if ((addr[0] == 0xfe && (addr[1] & 0xc0) == 0x80) ||
+               prefixMatch(addr, POLICIES[0].prefix, POLICIES[0].bits)) {
+        rank.scope = 2;
+    } else if (addr[0] == 0xfe && (addr[1] & 0xc0) == 0xc0) {
+        rank.scope = 5;
+    }
+    // loopback is always reachable
+    if ((entry.family == 4 && addr[12] == 127) ||
+        (entry.family == 6 && prefixMatch(addr, POLICIES[0].prefix, POLICIES[0].bits))) {
+        rank.usable = true;
+    }
+    return rank;
+}
+
+// Destination address selection per RFC 6724 section 6, for the rules
+// that don't need the chosen source address: 1, 2 (approximated by
+// family availability), 6 and 8. Ties keep the order of the answers.
+void GNAddressLookup::SortAddresses(std::vector<Entry>& entries) {
+    bool ipv4 = true;
+    bool ipv6 = true;
+    usableFamilies(ipv4, ipv6);
+    std::vector<std::pair<Rank, Entry> > ranked;
+    ranked.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        ranked.push_back(std::make_pair(rankAddress(entries[i], ipv4, ipv6), entries[i]));
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+        [](const std::pair<Rank, Entry>& a, const std::pair<Rank, Entry>& b) {
+            if (a.first.usable != b.first.usable) {
+                return a.first.usable;
+            }
+            if (a.first.precedence != b.first.precedence) {
+                return a.first.precedence > b.first.precedence;
+            }
+            return a.first.scope < b.first.scope;
+        });
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        entries[i] = ranked[i].second;
+    }
+}
+
+static Local<Value> entriesToArray(const std::vector<GNAddressLookup::Entry>& entries) {
+    Local<Array> result = Nan::New<Array>(entries.size());
+    Local<String> addressKey = Nan::New<String>("address").ToLocalChecked();
+    Local<String> familyKey = Nan::New<String>("family").ToLocalChecked();
+    Local<String> ttlKey = Nan::New<String>("ttl").ToLocalChecked();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Local<Object> entry = Nan::New<Object>();
+        Nan::Set(entry, addressKey, Nan::New<String>(entries[i].address).ToLocalChecked());
+        Nan::Set(entry, familyKey, Nan::New<Integer>(entries[i].family));
+        Nan::Set(entry, ttlKey, Nan::New<Number>(entries[i].ttl));
+        Nan::Set(result, i, entry);
+    }
+    return result;
+}
+
+void GNAddressLookup::Callback(getdns_context* context,
+                               getdns_callback_type_t cbType,
+                               getdns_dict* response,
+                               void* userArg,
+                               getdns_transaction_t transId) {
+    Nan::HandleScope scope;
+    AddressQuery* query = static_cast<AddressQuery*>(userArg);
+    std::vector<Entry> entries;
+    int errCode = cbType;
+    if (cbType == GETDNS_CALLBACK_COMPLETE) {
+        uint32_t status = GETDNS_RESPSTATUS_GOOD;
+        getdns_dict_get_int(response, "status", &status);
+        GNUtil::forEachRR(response, "answer", [&entries, query](getdns_dict* rr, uint32_t type) {
+            int family = type == GETDNS_RRTYPE_A ? 4 : 6;
+            if (query->family && query->family != family) {
+                return;
+            }
+            char* addrStr = GNUtil::rrAddressString(rr, type);
+            if (addrStr) {
+                Entry entry;
+                entry.address = addrStr;
+                entry.family = family;
+                entry.ttl = 0;
+                getdns_dict_get_int(rr, "ttl", &entry.ttl);
+                entries.push_back(entry);
+                free(addrStr);
+            }
+        });
+        // no addresses is a not found, with the lookup status as code
+        errCode = entries.empty() ? (status == GETDNS_RESPSTATUS_GOOD ? GETDNS_RESPSTATUS_NO_NAME : status) : 0;
+    }
+    if (response) {
+        getdns_dict_destroy(response);
+    }
+
+    Local<Value> argv[2];
+    if (errCode) {
+        argv[0] = GNUtil::makeErrorObj("Lookup failed.", errCode);
+        argv[1] = Nan::Null();
+    } else {
+        SortAddresses(entries);
+        if (query->ctx->addressCache_) {
+            query->ctx->addressCache_->Put(query->key, uv_now(uv_default_loop()), entries);
+        }
+        argv[0] = Nan::Null();
+        argv[1] = entriesToArray(entries);
+    }
+    Nan::TryCatch try_catch;
+    query->callback->Call(Nan::GetCurrentContext()->Global(), 2, argv);
+    if (try_catch.HasCaught())
+        Nan::FatalException(try_catch);
+
+    query->ctx->Unref();
+    delete query->callback;
+    delete query;
+}
+
+// Handle ctx.lookupAddresses(name, family, callback)
+// family is 4, 6 or 0 for both. Cached answers call back synchronously.
+NAN_METHOD(GNAddressLookup::Start) {
+    if (info.Length() < 3) {
+        return Nan::ThrowTypeError(Nan::New<String>("At least 3 arguments are required.").ToLocalChecked());
+    }
+    // last arg must be a callback
+    Local<Value> last = info[info.Length() - 1];
+    if (!last->IsFunction()) {
+        return Nan::ThrowTypeError(Nan::New<String>("Final argument must be a function.").ToLocalChecked());
+    }
+    Local<Function> localCb = Local<Function>::Cast(last);
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        Local<Value> err = GNUtil::makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        return;
+    }
+    // take first arg and make it a string
+    Nan::Utf8String name(info[0]);
+    uint32_t family = info[1]->IsNumber() ? Nan::To<uint32_t>(info[1]).FromJust() : 0;
+    if (family != 0 && family != 4 && family != 6) {
+        Local<Value> err = GNUtil::makeErrorObj("Second argument must be 0, 4 or 6", GETDNS_RETURN_INVALID_PARAMETER);
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        return;
+    }
+
+    std::string key = std::to_string(family) + ":";
+    for (const char* c = *name; *c; ++c) {
+        key.push_back((char) tolower((unsigned char) *c));
+    }
+    if (!key.empty() && key[key.size() - 1] != '.') {
+        key.push_back('.');
+    }
+    if (!ctx->addressCache_) {
+        ctx->addressCache_ = new GNAddressLookup::Cache();
+    }
+    std::vector<Entry> cached;
+    if (ctx->addressCache_->Get(key, uv_now(uv_default_loop()), cached)) {
+        Local<Value> cbArgs[] = { Nan::Null(), entriesToArray(cached) };
+        Nan::Call(localCb, Nan::GetCurrentContext()->Global(), 2, cbArgs);
+        info.GetReturnValue().Set(Nan::Null());
+        return;
+    }
+
+    AddressQuery* query = new AddressQuery();
+    query->ctx = ctx;
+    query->callback = new Nan::Callback(localCb);
+    query->key = key;
+    query->family = (int) family;
+    ctx->Ref();
+
+    getdns_transaction_t transId;
+    getdns_return_t r;
+    if (family == 0) {
+        r = ctx->Address(*name, NULL, query, &transId, GNAddressLookup::Callback);
+    } else {
+        r = ctx->General(*name, family == 4 ? GETDNS_RRTYPE_A : GETDNS_RRTYPE_AAAA,
+                         NULL, query, &transId, GNAddressLookup::Callback);
+    }
+    if (r != GETDNS_RETURN_GOOD) {
+        ctx->Unref();
+        delete query->callback;
+        delete query;
+        Local<Value> err = GNUtil::makeErrorObj("Error issuing query", r);
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        return;
+    }
+    // done. return as buffer
+    info.GetReturnValue().Set(GNUtil::convertToBuffer(&transId, 8));
+}
+
+// Handle ctx.clearAddressCache()
+NAN_METHOD(GNAddressLookup::ClearCache) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (ctx && ctx->addressCache_) {
+        ctx->addressCache_->Clear();
+    }
+}
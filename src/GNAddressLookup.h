@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_ADDRESS_LOOKUP_H_
+#define _GN_ADDRESS_LOOKUP_H_
+
+#include <node.h>
+#include <nan.h>
+#include <getdns/getdns.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class GNContext;
+
+// getaddrinfo()-like address lookups returning plain, RFC 6724 ordered
+// address lists, with a per context TTL-respecting cache.
+class GNAddressLookup {
+public:
+    typedef struct Entry {
+        std::string address;
+        int family;
+        uint32_t ttl;
+    } Entry;
+
+    // Per context cache of ordered answers, keyed by family and name
+    class Cache {
+    public:
+        Cache() { }
+        bool Get(const std::string& key, uint64_t now, std::vector<Entry>& entries);
+        void Put(const std::string& key, uint64_t now, const std::vector<Entry>& entries);
+        void Clear() { records_.clear(); }
+
+    private:
+        typedef struct Record {
+            uint64_t expires;
+            std::vector<Entry> entries;
+        } Record;
+
+        std::unordered_map<std::string, Record> records_;
+    };
+
+    // ctx.lookupAddresses(name, family, callback)
+    static NAN_METHOD(Start);
+
+    // ctx.clearAddressCache()
+    static NAN_METHOD(ClearCache);
+
+private:
+    static void SortAddresses(std::vector<Entry>& entries);
+    static void Callback(getdns_context* context,
+                         getdns_callback_type_t cbType,
+                         getdns_dict* response,
+                         void* userArg,
+                         getdns_transaction_t transId);
+};
+
+#endif
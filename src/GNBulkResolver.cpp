@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNBulkResolver.h"
+#include "GNContext.h"
+#include "GNUtil.h"
+
+#include <getdns/getdns_extra.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+using namespace v8;
+
+// Stop submitting queries while this much output is waiting to be written.
+static const size_t OUTPUT_HIGH_WATER = 1024 * 1024;
+
+static const size_t DEFAULT_CONCURRENCY = 100;
+
+// Longer lines can't be names, even with every character escaped, and
+// are failed with their first MAX_LINE_LENGTH characters as the name.
+static const size_t MAX_LINE_LENGTH = 1024;
+
+// Per query user arg
+typedef struct BulkQuery {
+    GNBulkResolver* bulk;
+    std::string name;
+} BulkQuery;
+
+static void appendUint16(std::string& out, uint16_t val) {
+    out.push_back((char) (val >> 8));
+    out.push_back((char) (val & 0xff));
+}
+
+static void appendUint32(std::string& out, uint32_t val) {
+    appendUint16(out, (uint16_t) (val >> 16));
+    appendUint16(out, (uint16_t) (val & 0xffff));
+}
+
+// Names come from untrusted input, so escape them before embedding in JSON.
+static void appendJsonString(std::string& out, const std::string& str) {
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    for (size_t i = 0; i < str.size(); ++i) {
+        unsigned char c = (unsigned char) str[i];
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back((char) c);
+        } else if (c < 0x20) {
+            out.append("\\u00");
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 0xf]);
+        } else {
+            out.push_back((char) c);
+        }
+    }
+    out.push_back('"');
+}
+
+GNBulkResolver::GNBulkResolver(GNContext* ctx, Nan::Callback* callback) :
+    ctx_(ctx), callback_(callback), extension_(NULL),
+    type_(GETDNS_RRTYPE_A), concurrency_(DEFAULT_CONCURRENCY), binary_(false),
+    input_(-1), output_(-1),
+    inflight_(0), reading_(false), eof_(false), writing_(false),
+    pumping_(false), finished_(false), error_(0),
+    issueError_(GETDNS_RETURN_GOOD),
+    read_(0), answered_(0), failed_(0) {
+    readReq_.data = this;
+    writeReq_.data = this;
+}
+
+GNBulkResolver::~GNBulkResolver() {
+    if (extension_) {
+        getdns_dict_destroy(extension_);
+    }
+    delete callback_;
+}
+
+void GNBulkResolver::ReadMore() {
+    if (reading_ || eof_ || error_ || names_.size() >= concurrency_) {
+        return;
+    }
+    reading_ = true;
+    uv_buf_t buf = uv_buf_init(readBuf_, sizeof(readBuf_));
+    int r = uv_fs_read(uv_default_loop(), &readReq_, input_, &buf, 1, -1, GNBulkResolver::OnRead);
+    if (r < 0) {
+        reading_ = false;
+        error_ = r;
+    }
+}
+
+// One name per line; blank lines and #comments are skipped.
+void GNBulkResolver::ParseChunk(const char* data, size_t size) {
+    size_t start = 0;
+    for (size_t i = 0; i <= size; ++i) {
+        if (i < size && data[i] != '\n') {
+            continue;
+        }
+        // NOTE: keeps one character past the limit to tell over-long lines
+        size_t room = MAX_LINE_LENGTH + 1 - partial_.size();
+        partial_.append(data + start, std::min(i - start, room));
+        start = i + 1;
+        if (i == size && !eof_) {
+            // incomplete line, wait for the next chunk
+            break;
+        }
+        size_t b = partial_.find_first_not_of(" \t\r");
+        size_t e = partial_.find_last_not_of(" \t\r");
+        if (partial_.size() > MAX_LINE_LENGTH) {
+            read_++;
+            Emit(partial_.substr(0, MAX_LINE_LENGTH), GETDNS_CALLBACK_ERROR, NULL);
+        } else if (b != std::string::npos && partial_[b] != '#') {
+            names_.push_back(partial_.substr(b, e - b + 1));
+            read_++;
+        }
+        partial_.clear();
+    }
+}
+
+void GNBulkResolver::OnRead(uv_fs_t* req) {
+    GNBulkResolver* bulk = static_cast<GNBulkResolver*>(req->data);
+    ssize_t result = req->result;
+    uv_fs_req_cleanup(req);
+    bulk->reading_ = false;
+    if (result < 0) {
+        bulk->error_ = (int) result;
+    } else {
+        if (result == 0) {
+            bulk->eof_ = true;
+        }
+        bulk->ParseChunk(bulk->readBuf_, (size_t) result);
+    }
+    bulk->Pump();
+}
+
+void GNBulkResolver::Pump() {
+    if (pumping_) {
+        return;
+    }
+    pumping_ = true;
+    while (!error_ && inflight_ < concurrency_ && !names_.empty() &&
+           outBuf_.size() < OUTPUT_HIGH_WATER) {
+        if (!ctx_->context_) {
+            // context was destroyed underneath us
+            error_ = UV_ECANCELED;
+            break;
+        }
+        BulkQuery* query = new BulkQuery();
+        query->bulk = this;
+        query->name.swap(names_.front());
+        names_.pop_front();
+
+        inflight_++;
+        getdns_transaction_t transId;
+        getdns_return_t r = ctx_->General(query->name.c_str(), type_,
+                                          extension_, query, &transId,
+                                          GNBulkResolver::Callback,
+                                          GNScheduler::Bulk);
+        if (r == GETDNS_RETURN_BAD_DOMAIN_NAME) {
+            inflight_--;
+            Emit(query->name, GETDNS_CALLBACK_ERROR, NULL);
+            delete query;
+        } else if (r != GETDNS_RETURN_GOOD) {
+            // NOTE: the context refuses the other names as well, when
+            // draining or over a rate limit with queue: false
+            inflight_--;
+            failed_++;
+            delete query;
+            error_ = UV_ECANCELED;
+            issueError_ = r;
+        }
+    }
+    ReadMore();
+    Flush();
+    pumping_ = false;
+    MaybeFinish();
+}
+
+void GNBulkResolver::Emit(const std::string& name, getdns_callback_type_t cbType,
+                          getdns_dict* response) {
+    if (cbType == GETDNS_CALLBACK_COMPLETE) {
+        answered_++;
+    } else {
+        failed_++;
+    }
+    if (error_) {
+        return;
+    }
+    uint32_t status = 0;
+    if (response) {
+        getdns_dict_get_int(response, "status", &status);
+    }
+    if (binary_) {
+        // Record layout, all integers in network order:
+        // name length (16), name, type (16), callback type (32),
+        // status (32), wire length (32), wire reply
+        getdns_bindata* wire = NULL;
+        getdns_list* replies = NULL;
+        if (response &&
+            getdns_dict_get_list(response, "replies_full", &replies) == GETDNS_RETURN_GOOD) {
+            getdns_list_get_bindata(replies, 0, &wire);
+        }
+        appendUint16(outBuf_, (uint16_t) name.size());
+        outBuf_.append(name);
+        appendUint16(outBuf_, type_);
+        appendUint32(outBuf_, (uint32_t) cbType);
+        appendUint32(outBuf_, status);
+        appendUint32(outBuf_, wire ? (uint32_t) wire->size : 0);
+        if (wire) {
+            outBuf_.append((const char*) wire->data, wire->size);
+        }
+        return;
+    }
+    outBuf_.append("{\"name\":");
+    appendJsonString(outBuf_, name);
+    outBuf_.append(",\"type\":");
+    outBuf_.append(std::to_string(type_));
+    outBuf_.append(",\"callback_type\":");
+    outBuf_.append(std::to_string((int) cbType));
+    if (response) {
+        char* json = getdns_print_json_dict(response, 0);
+        if (json) {
+            outBuf_.append(",\"status\":");
+            outBuf_.append(std::to_string(status));
+            outBuf_.append(",\"response\":");
+            outBuf_.append(json);
+            free(json);
+        }
+    }
+    outBuf_.append("}\n");
+}
+
+void GNBulkResolver::Callback(getdns_context* context,
+                              getdns_callback_type_t cbType,
+                              getdns_dict* response,
+                              void* userArg,
+                              getdns_transaction_t transId) {
+    BulkQuery* query = static_cast<BulkQuery*>(userArg);
+    GNBulkResolver* bulk = query->bulk;
+    bulk->inflight_--;
+    bulk->Emit(query->name, cbType, response);
+    if (response) {
+        getdns_dict_destroy(response);
+    }
+    delete query;
+    bulk->Pump();
+}
+
+void GNBulkResolver::Flush() {
+    if (writing_ || error_ || outBuf_.empty()) {
+        return;
+    }
+    writing_ = true;
+    writeBuf_.swap(outBuf_);
+    outBuf_.clear();
+    uv_buf_t buf = uv_buf_init(&writeBuf_[0], writeBuf_.size());
+    int r = uv_fs_write(uv_default_loop(), &writeReq_, output_, &buf, 1, -1, GNBulkResolver::OnWrite);
+    if (r < 0) {
+        writing_ = false;
+        error_ = r;
+    }
+}
+
+void GNBulkResolver::OnWrite(uv_fs_t* req) {
+    GNBulkResolver* bulk = static_cast<GNBulkResolver*>(req->data);
+    ssize_t result = req->result;
+    uv_fs_req_cleanup(req);
+    bulk->writing_ = false;
+    if (result < 0) {
+        bulk->error_ = (int) result;
+    } else if ((size_t) result < bulk->writeBuf_.size()) {
+        // short write (pipes), put the rest back in front
+        bulk->outBuf_.insert(0, bulk->writeBuf_, (size_t) result, std::string::npos);
+    }
+    bulk->writeBuf_.clear();
+    bulk->Pump();
+}
+
+void GNBulkResolver::MaybeFinish() {
+    if (finished_ || pumping_ || inflight_ || reading_ || writing_) {
+        return;
+    }
+    if (!error_ && !(eof_ && names_.empty() && outBuf_.empty())) {
+        return;
+    }
+    finished_ = true;
+
+    Nan::HandleScope scope;
+    Local<Value> argv[2];
+    if (issueError_ != GETDNS_RETURN_GOOD) {
+        argv[0] = GNUtil::makeErrorObj("Error issuing query", issueError_);
+    } else if (error_) {
+        argv[0] = GNUtil::makeErrorObj(uv_strerror(error_), GETDNS_RETURN_GENERIC_ERROR);
+    } else {
+        argv[0] = Nan::Null();
+    }
+    Local<Object> stats = Nan::New<Object>();
+    Nan::Set(stats, Nan::New<String>("read").ToLocalChecked(), Nan::New<Number>((double) read_));
+    Nan::Set(stats, Nan::New<String>("answered").ToLocalChecked(), Nan::New<Number>((double) answered_));
+    Nan::Set(stats, Nan::New<String>("failed").ToLocalChecked(), Nan::New<Number>((double) failed_));
+    argv[1] = stats;
+
+    Nan::TryCatch try_catch;
+    callback_->Call(Nan::GetCurrentContext()->Global(), 2, argv);
+    if (try_catch.HasCaught())
+        Nan::FatalException(try_catch);
+
+    ctx_->Unref();
+    delete this;
+}
+
+// Handle ctx.bulkLookup(options, callback)
+NAN_METHOD(GNBulkResolver::Start) {
+    if (info.Length() < 2) {
+        return Nan::ThrowTypeError(Nan::New<String>("At least 2 arguments are required.").ToLocalChecked());
+    }
+    // last arg must be a callback
+    Local<Value> last = info[info.Length() - 1];
+    if (!last->IsFunction()) {
+        return Nan::ThrowTypeError(Nan::New<String>("Final argument must be a function.").ToLocalChecked());
+    }
+    Local<Function> localCb = Local<Function>::Cast(last);
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        Local<Value> err = GNUtil::makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        return;
+    }
+    if (!GNUtil::isDictionaryObject(info[0])) {
+        return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("options", GETDNS_RETURN_INVALID_PARAMETER));
+    }
+    Local<Object> opts = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+
+    Local<Value> input = Nan::Get(opts, Nan::New<String>("input").ToLocalChecked()).ToLocalChecked();
+    if (!input->IsNumber()) {
+        return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("input", GETDNS_RETURN_INVALID_PARAMETER));
+    }
+    Local<Value> output = Nan::Get(opts, Nan::New<String>("output").ToLocalChecked()).ToLocalChecked();
+    if (!output->IsNumber()) {
+        return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("output", GETDNS_RETURN_INVALID_PARAMETER));
+    }
+    Local<Value> type = Nan::Get(opts, Nan::New<String>("type").ToLocalChecked()).ToLocalChecked();
+    if (!type->IsUndefined() && !type->IsNumber()) {
+        return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("type", GETDNS_RETURN_INVALID_PARAMETER));
+    }
+    Local<Value> concurrency = Nan::Get(opts, Nan::New<String>("concurrency").ToLocalChecked()).ToLocalChecked();
+    if (!concurrency->IsUndefined() &&
+        !(concurrency->IsNumber() && Nan::To<uint32_t>(concurrency).FromJust() > 0)) {
+        return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("concurrency", GETDNS_RETURN_INVALID_PARAMETER));
+    }
+    bool binary = false;
+    Local<Value> format = Nan::Get(opts, Nan::New<String>("format").ToLocalChecked()).ToLocalChecked();
+    if (!format->IsUndefined()) {
+        Nan::Utf8String formatStr(format);
+        if (strcmp(*formatStr, "binary") == 0) {
+            binary = true;
+        } else if (strcmp(*formatStr, "ndjson") != 0) {
+            return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("format", GETDNS_RETURN_INVALID_PARAMETER));
+        }
+    }
+    Local<Value> extensions = Nan::Get(opts, Nan::New<String>("extensions").ToLocalChecked()).ToLocalChecked();
+
+    GNBulkResolver* bulk = new GNBulkResolver(ctx, new Nan::Callback(localCb));
+    bulk->input_ = (uv_file) Nan::To<int32_t>(input).FromJust();
+    bulk->output_ = (uv_file) Nan::To<int32_t>(output).FromJust();
+    bulk->binary_ = binary;
+    if (type->IsNumber()) {
+        bulk->type_ = (uint16_t) Nan::To<uint32_t>(type).FromJust();
+    }
+    if (concurrency->IsNumber()) {
+        bulk->concurrency_ = Nan::To<uint32_t>(concurrency).FromJust();
+    }
+    if (extensions->IsObject()) {
+        bulk->extension_ = GNUtil::convertToDict(Nan::To<v8::Object>(extensions).ToLocalChecked());
+    }
+    ctx->Ref();
+    bulk->Pump();
+    info.GetReturnValue().Set(Nan::True());
+}
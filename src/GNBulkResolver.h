@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_BULK_RESOLVER_H_
+#define _GN_BULK_RESOLVER_H_
+
+#include <node.h>
+#include <nan.h>
+#include <uv.h>
+#include <getdns/getdns.h>
+
+#include <deque>
+#include <string>
+
+class GNContext;
+
+// Streams names from an input fd through a context and writes
+// the results to an output fd, without going through JS per query.
+class GNBulkResolver {
+public:
+    // ctx.bulkLookup(options, callback)
+    static NAN_METHOD(Start);
+
+private:
+    GNBulkResolver(GNContext* ctx, Nan::Callback* callback);
+    ~GNBulkResolver();
+
+    // Input side
+    void ReadMore();
+    void ParseChunk(const char* data, size_t size);
+    static void OnRead(uv_fs_t* req);
+
+    // Query side
+    void Pump();
+    void Emit(const std::string& name, getdns_callback_type_t cbType,
+              getdns_dict* response);
+    static void Callback(getdns_context* context,
+                         getdns_callback_type_t cbType,
+                         getdns_dict* response,
+                         void* userArg,
+                         getdns_transaction_t transId);
+
+    // Output side
+    void Flush();
+    static void OnWrite(uv_fs_t* req);
+
+    void MaybeFinish();
+
+    GNContext* ctx_;
+    Nan::Callback* callback_;
+    getdns_dict* extension_;
+    uint16_t type_;
+    size_t concurrency_;
+    bool binary_;
+
+    uv_file input_;
+    uv_file output_;
+    uv_fs_t readReq_;
+    uv_fs_t writeReq_;
+    char readBuf_[65536];
+
+    std::string partial_;
+    std::deque<std::string> names_;
+    std::string outBuf_;
+    std::string writeBuf_;
+
+    size_t inflight_;
+    bool reading_;
+    bool eof_;
+    bool writing_;
+    bool pumping_;
+    bool finished_;
+    int error_;
+    // why the context refused a lookup, with error_ UV_ECANCELED
+    getdns_return_t issueError_;
+
+    // Counters reported to the final callback
+    uint64_t read_;
+    uint64_t answered_;
+    uint64_t failed_;
+};
+
+#endif
@@ -26,6 +26,7 @@
  */
 
 #include "GNConstants.h"
+#include "GNScheduler.h"
 #include <getdns/getdns_extra.h>
 #include <getdns/getdns.h>
 #include <nan.h>
@@ -57,6 +58,8 @@ void GNConstants::Init(Local<Object> target) {
     SetConstant("RETURN_INVALID_PARAMETER",GETDNS_RETURN_INVALID_PARAMETER,exports);
     SetConstant("RETURN_NOT_IMPLEMENTED",GETDNS_RETURN_NOT_IMPLEMENTED,exports);
     SetConstant("RETURN_NEED_MORE_SPACE",GETDNS_RETURN_NEED_MORE_SPACE,exports);
+    // getdns-node only, for lookups over the rate_limit of a context
+    SetConstant("RETURN_RATE_LIMITED",GNScheduler::RATE_LIMITED,exports);
     SetConstant("DNSSEC_SECURE",GETDNS_DNSSEC_SECURE,exports);
     SetConstant("DNSSEC_BOGUS",GETDNS_DNSSEC_BOGUS,exports);
     SetConstant("DNSSEC_INDETERMINATE",GETDNS_DNSSEC_INDETERMINATE,exports);
@@ -207,6 +210,15 @@ void GNConstants::Init(Local<Object> target) {
     SetConstant("RRTYPE_CAA",GETDNS_RRTYPE_CAA,exports);
     SetConstant("RRTYPE_TA",GETDNS_RRTYPE_TA,exports);
     SetConstant("RRTYPE_DLV",GETDNS_RRTYPE_DLV,exports);
+
+// NOTE: SVCB and HTTPS were added in getdns v1.7.0; fall back to the IANA assigned values for older versions.
+#ifdef GETDNS_RRTYPE_SVCB
+    SetConstant("RRTYPE_SVCB",GETDNS_RRTYPE_SVCB,exports);
+    SetConstant("RRTYPE_HTTPS",GETDNS_RRTYPE_HTTPS,exports);
+#else
+    SetConstant("RRTYPE_SVCB",64,exports);
+    SetConstant("RRTYPE_HTTPS",65,exports);
+#endif
     SetConstant("RRCLASS_IN",GETDNS_RRCLASS_IN,exports);
     SetConstant("RRCLASS_CH",GETDNS_RRCLASS_CH,exports);
     SetConstant("RRCLASS_HS",GETDNS_RRCLASS_HS,exports);
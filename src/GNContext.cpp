@@ -28,6 +28,13 @@
 #include "GNContext.h"
 #include "GNUtil.h"
 #include "GNConstants.h"
+#include "GNBulkResolver.h"
+#include "GNReverseSweep.h"
+#include "GNServiceEndpoints.h"
+#include "GNRecords.h"
+#include "GNZoneFiles.h"
+#include "GNWarmup.h"
+#include "GNDeadlines.h"
 
 #include <getdns/getdns_extra.h>
 #include <arpa/inet.h>
@@ -38,6 +45,10 @@
 #include <stdlib.h>
 #include <sys/time.h>
 
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
 using namespace v8;
 
 // Enum to distinguish which helper is being used.
@@ -47,25 +58,51 @@ typedef enum LookupType {
     GNService
 } LookupType;
 
-// Callback data passed to getdns callback as userarg
+// Callback data passed to getdns callback as userarg. The handles are
+// emptied, not freed, when the record is released for reuse.
 typedef struct CallbackData {
-    Nan::Callback* callback;
+    Nan::Callback callback;
+    // set instead of callback when the query returns a promise
+    Nan::Persistent<Promise::Resolver> resolver;
     GNContext* ctx;
+    // context the record is recycled by, NULL when allocated on its own
+    GNContext* owner;
+    // set by resolveRecords to shape the answers of this type
+    uint16_t recordType;
+    bool withTtl;
+    // set when the lookup has its own timeout
+    bool deadline;
 } CallbackData;
 
-// Helper to create an error object for lookup callbacks
-static Local<Value> makeErrorObj(const char* msg, int code) {
-    Local<Object> obj = Nan::New<Object>();
-    Nan::Set(obj, Nan::New<String>("msg").ToLocalChecked(), Nan::New<String>(msg).ToLocalChecked());
-    Nan::Set(obj, Nan::New<String>("code").ToLocalChecked(), Nan::New<Integer>(code));
-    return obj;
-}
+struct PendingLookup {
+    GNContext* ctx;
+    // the callback and argument of whoever issued the lookup
+    void* userArg;
+    getdns_callback_t callback;
+    // for ctx.pending(), the name is the address of hostname lookups
+    GNEngine::QueryKind kind;
+    std::string name;
+    uint16_t type;
+    uint64_t startedAt;
+};
 
-static Local<Value> makeTypeErrorWithCode(const char* msg, int code) {
-    Local<Object> error = Nan::TypeError(Nan::New<String>(msg).ToLocalChecked()).As<Object>();
-    Nan::Set(error, Nan::New<String>("code").ToLocalChecked(), Nan::New<Integer>(code));
-    return error;
-}
+// Shared state for the queries issued by a single lookupTypes call
+typedef struct MultiTypeData {
+    Nan::Callback* callback;
+    Nan::Callback* onEach;
+    Nan::Persistent<Object> results;
+    Nan::Persistent<Object> failures;
+    getdns_dict* extension;
+    GNContext* ctx;
+    size_t remaining;
+    int firstError;
+} MultiTypeData;
+
+// Per type user arg for lookupTypes
+typedef struct MultiTypeQuery {
+    MultiTypeData* multi;
+    uint16_t type;
+} MultiTypeQuery;
 
 // Helper to create an address dictionary from string
 // Must be freed by the user
@@ -381,7 +418,9 @@ static getdns_return_t setPinset(getdns_context* context, Local<Value> opt) {
     return GETDNS_RETURN_INVALID_PARAMETER;
 }
 
-static getdns_return_t setUpstreams(getdns_context* context, Local<Value> opt) {
+// Build the upstream list of the upstreams option. Search suffixes in it
+// are set on the context right away.
+static getdns_return_t buildUpstreams(getdns_context* context, Local<Value> opt, getdns_list** result) {
     if (opt->IsArray()) {
         getdns_list* upstreams = getdns_list_create();
         Local<Array> values = Local<Array>::Cast(opt);
@@ -430,16 +469,35 @@ static getdns_return_t setUpstreams(getdns_context* context, Local<Value> opt) {
                 getdns_list_set_dict(upstreams, len, ipDict);
                 getdns_dict_destroy(ipDict);
             } else {
+                getdns_list_destroy(upstreams);
                 return GETDNS_RETURN_CONTEXT_UPDATE_FAIL;
             }
         }
-        getdns_return_t r = getdns_context_set_upstream_recursive_servers(context, upstreams);
-        getdns_list_destroy(upstreams);
-        return r;
+        *result = upstreams;
+        return GETDNS_RETURN_GOOD;
     }
     return GETDNS_RETURN_INVALID_PARAMETER;
 }
 
+static getdns_return_t setUpstreams(getdns_context* context, Local<Value> opt) {
+    getdns_list* upstreams = NULL;
+    getdns_return_t r = buildUpstreams(context, opt, &upstreams);
+    if (r != GETDNS_RETURN_GOOD) {
+        return r;
+    }
+    r = getdns_context_set_upstream_recursive_servers(context, upstreams);
+    getdns_list_destroy(upstreams);
+    return r;
+}
+
+
+static getdns_return_t setIdleTimeout(getdns_context* context, Local<Value> opt) {
+    if (opt->IsNumber()) {
+        uint64_t num = (uint64_t) Nan::To<double>(opt).FromJust();
+        return getdns_context_set_idle_timeout(context, num);
+    }
+    return GETDNS_RETURN_INVALID_PARAMETER;
+}
 
 static getdns_return_t setTimeout(getdns_context* context, Local<Value> opt) {
     if (opt->IsNumber()) {
@@ -480,57 +538,28 @@ static getdns_return_t setReturnDnssecStatus(getdns_context* context, Local<Valu
 // set alternate root servers from a file passed in
 static getdns_return_t setDnsRootServers(getdns_context* context, Local<Value> opt)
 {
-    FILE *fh;
-    getdns_list *hints = NULL;
-
     if (opt->IsString()) {
-         Nan::Utf8String roots(opt);
-        if (!(fh = fopen((char *)*roots, "r"))) {
-            // TODO: remove all fprintf.
-            fprintf(stderr, "Could not open %s\n", (char *)*roots);
-            return GETDNS_RETURN_GENERIC_ERROR;
+        getdns_list *hints = NULL;
+        getdns_return_t r = GNZoneFiles::Get(*Nan::Utf8String(opt), &hints);
+        if (r != GETDNS_RETURN_GOOD) {
+            return r;
         }
-        if (getdns_fp2rr_list(fh, &hints, NULL, 3600)) {
-            // TODO: remove all fprintf.
-            fprintf(stderr,"Could not parse "
-                "\"%s\"\n", (char *)*roots);
-            return GETDNS_RETURN_GENERIC_ERROR;
-        }
-        fclose(fh);
-        getdns_return_t r = getdns_context_set_dns_root_servers(context, hints);
-        getdns_list_destroy(hints);
-        hints = NULL;
-        return r;
+        return getdns_context_set_dns_root_servers(context, hints);
     }
     return GETDNS_RETURN_INVALID_PARAMETER;
 }
 
 
-// Read the location of the Trust anchor and pass it to getdns.
-// TODO: actually pass in the trust anchor.
+// Pass the trust anchors read from a file to getdns.
 static getdns_return_t setTrustAnchor(getdns_context *context, Local<Value> opt)
 {
-    FILE *fh;
-    getdns_list *tas = NULL;
-
     if (opt->IsString()) {
-         Nan::Utf8String ta(opt);
-
-       if (!(fh = fopen((char *)*ta, "r"))) {
-           fprintf(stderr, "Could not open %s\n", (char *)*ta);
-           return GETDNS_RETURN_GENERIC_ERROR;
+        getdns_list *tas = NULL;
+        getdns_return_t r = GNZoneFiles::Get(*Nan::Utf8String(opt), &tas);
+        if (r != GETDNS_RETURN_GOOD) {
+            return r;
         }
-        if (getdns_fp2rr_list(fh, &tas, NULL, 3600)) {
-            // TODO: remove all fprintf.
-            fprintf(stderr,"Could not parse "
-                "\"%s\"\n", (char *)*ta);
-            return GETDNS_RETURN_GENERIC_ERROR;
-        }
-        fclose(fh);
-        getdns_return_t r = getdns_context_set_dnssec_trust_anchors(context, tas);
-        getdns_list_destroy(tas);
-        tas = NULL;
-        return r;
+        return getdns_context_set_dnssec_trust_anchors(context, tas);
     }
     return GETDNS_RETURN_INVALID_PARAMETER;
 }
@@ -547,6 +576,7 @@ static OptionSetter SETTERS[] = {
     { "upstreams", setUpstreams },
     { "upstream_recursive_servers", setUpstreams },
     { "timeout", setTimeout },
+    { "idle_timeout", setIdleTimeout },
     { "dnssecallowedskew", setDnssecAllowedSkew },
     { "use_threads", setUseThreads },
     { "return_dnssec_status", setReturnDnssecStatus },
@@ -574,7 +604,8 @@ typedef struct Uint8OptionSetter {
 static Uint8OptionSetter UINT8_OPTION_SETTERS[] = {
     { "edns_extended_rcode", getdns_context_set_edns_extended_rcode },
     { "edns_version", getdns_context_set_edns_version },
-    { "edns_do_bit", getdns_context_set_edns_do_bit }
+    { "edns_do_bit", getdns_context_set_edns_do_bit },
+    { "round_robin_upstreams", getdns_context_set_round_robin_upstreams }
 };
 
 static size_t NUM_UINT8_SETTERS = sizeof(UINT8_OPTION_SETTERS) / sizeof(Uint8OptionSetter);
@@ -591,6 +622,80 @@ static Uint16OptionSetter UINT16_OPTION_SETTERS[] = {
 
 static size_t NUM_UINT16_SETTERS = sizeof(UINT16_OPTION_SETTERS) / sizeof(Uint16OptionSetter);
 
+// Where the setter of a property is: its table and index in that table
+typedef enum SetterKind {
+    ValueSetter,
+    Uint8Setter,
+    Uint16Setter
+} SetterKind;
+
+typedef struct SetterRef {
+    SetterKind kind;
+    size_t index;
+} SetterRef;
+
+// Find the setter of a property, NULL for unknown properties
+static const SetterRef* findSetter(const char* name) {
+    static std::unordered_map<std::string, SetterRef> setters;
+    if (setters.empty()) {
+        for (size_t s = 0; s < NUM_SETTERS; ++s) {
+            setters[SETTERS[s].opt_name] = { ValueSetter, s };
+        }
+        for (size_t s = 0; s < NUM_UINT8_SETTERS; ++s) {
+            setters[UINT8_OPTION_SETTERS[s].opt_name] = { Uint8Setter, s };
+        }
+        for (size_t s = 0; s < NUM_UINT16_SETTERS; ++s) {
+            setters[UINT16_OPTION_SETTERS[s].opt_name] = { Uint16Setter, s };
+        }
+    }
+    std::unordered_map<std::string, SetterRef>::const_iterator it = setters.find(name);
+    return it == setters.end() ? NULL : &it->second;
+}
+
+static bool isUpstreamSetter(const SetterRef* ref) {
+    return ref->kind == ValueSetter && SETTERS[ref->index].setter == setUpstreams;
+}
+
+static bool isRoundRobinSetter(const SetterRef* ref) {
+    return ref->kind == Uint8Setter && UINT8_OPTION_SETTERS[ref->index].setter == getdns_context_set_round_robin_upstreams;
+}
+
+static getdns_return_t applySetter(getdns_context* context, const SetterRef* ref, Local<Value> value) {
+    if (ref->kind == ValueSetter) {
+        return SETTERS[ref->index].setter(context, value);
+    }
+    if (!value->IsNumber()) {
+        return GETDNS_RETURN_INVALID_PARAMETER;
+    }
+    uint32_t optVal = Nan::To<uint32_t>(value).FromJust();
+    if (ref->kind == Uint8Setter) {
+        return UINT8_OPTION_SETTERS[ref->index].setter(context, (uint8_t)optVal);
+    }
+    return UINT16_OPTION_SETTERS[ref->index].setter(context, (uint16_t)optVal);
+}
+
+// Options that only apply when creating a context, they are not properties
+static const char* CREATION_OPTIONS[] = {
+    "threaded",
+    "allocator",
+    "scheduler",
+    "rate_limit",
+    "dnstap",
+    // handled in getdns.js
+    "warmup"
+};
+
+static size_t NUM_CREATION_OPTIONS = sizeof(CREATION_OPTIONS) / sizeof(const char*);
+
+static bool isCreationOption(const char* name) {
+    for (size_t i = 0; i < NUM_CREATION_OPTIONS; ++i) {
+        if (strcmp(CREATION_OPTIONS[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // End setters
 NAN_GETTER(GNContext::GetContextValue) {
     // context has no getters yet
@@ -603,45 +708,25 @@ NAN_SETTER(GNContext::SetContextValue) {
     if (!ctx) {
         return Nan::ThrowError("Context is invalid.");
     }
-    size_t s = 0;
-    for (s = 0; s < NUM_SETTERS; ++s) {
-        if (strcmp(SETTERS[s].opt_name, *name) == 0) {
-            getdns_return_t r = SETTERS[s].setter(ctx->context_, value);
-            if (r != GETDNS_RETURN_GOOD) {
-                Local<Value> typeError = makeTypeErrorWithCode(*name, r);
-                return Nan::ThrowError(typeError);
-            }
-            return;
-        }
+    const SetterRef* ref = findSetter(*name);
+    if (!ref) {
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode(*name, GETDNS_RETURN_INVALID_PARAMETER);
+        return Nan::ThrowError(typeError);
     }
-    if (!value->IsNumber()) {
-        Local<Value> typeError = makeTypeErrorWithCode(*name, GETDNS_RETURN_INVALID_PARAMETER);
+    // the engine thread must not use the context meanwhile
+    GNEngine::Pause pause(ctx->engine_);
+    getdns_return_t r = applySetter(ctx->context_, ref, value);
+    if (r != GETDNS_RETURN_GOOD) {
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode(*name, r);
         return Nan::ThrowError(typeError);
     }
-    for (s = 0; s < NUM_UINT8_SETTERS; ++s) {
-        if (strcmp(UINT8_OPTION_SETTERS[s].opt_name, *name) == 0) {
-            uint32_t optVal = Nan::To<uint32_t>(value).FromJust();
-            getdns_return_t r = UINT8_OPTION_SETTERS[s].setter(ctx->context_, (uint8_t)optVal);
-            if (r != GETDNS_RETURN_GOOD) {
-                Local<Value> typeError = makeTypeErrorWithCode(*name, r);
-                return Nan::ThrowError(typeError);
-            }
-            return;
-        }
+    if (isUpstreamSetter(ref)) {
+        ctx->appliedUpstreams_.clear();
     }
-    for (s = 0; s < NUM_UINT16_SETTERS; ++s) {
-        if (strcmp(UINT16_OPTION_SETTERS[s].opt_name, *name) == 0) {
-            uint32_t optVal = Nan::To<uint32_t>(value).FromJust();
-            getdns_return_t r = UINT16_OPTION_SETTERS[s].setter(ctx->context_, (uint16_t)optVal);
-            if (r != GETDNS_RETURN_GOOD) {
-                Local<Value> typeError = makeTypeErrorWithCode(*name, r);
-                return Nan::ThrowError(typeError);
-            }
-            return;
-        }
+    if (isRoundRobinSetter(ref)) {
+        // the user's value now, a running warmup must not undo it
+        ctx->warmupRoundRobin_ = false;
     }
-    Local<Value> typeError = makeTypeErrorWithCode(*name, GETDNS_RETURN_INVALID_PARAMETER);
-    return Nan::ThrowError(typeError);
 }
 
 void GNContext::InitProperties(Local<Object> ctx) {
@@ -661,12 +746,42 @@ void GNContext::InitProperties(Local<Object> ctx) {
     }
 }
 
-GNContext::GNContext() : context_(NULL) { }
+GNContext::GNContext() : context_(NULL), addressCache_(NULL), engine_(NULL), scheduler_(NULL), dnstap_(NULL), ring_(NULL), memory_(NULL), deadlines_(NULL),
+    warmups_(0), warmupRoundRobin_(false),
+    tracking_(NULL), trackingDone_(false), draining_(false), drainTimer_(NULL), drainStarted_(0), drainPending_(0) { }
 GNContext::~GNContext() {
+    if (ring_ != NULL) {
+        ring_->Close();
+        ring_ = NULL;
+    }
+    if (engine_ != NULL) {
+        engine_->Destroy();
+        engine_ = NULL;
+        context_ = NULL;
+    }
     if (context_ != NULL) {
         getdns_context_destroy(context_);
         context_ = NULL;
     }
+    if (deadlines_ != NULL) {
+        deadlines_->Close();
+        deadlines_ = NULL;
+    }
+    if (scheduler_ != NULL) {
+        scheduler_->Close();
+        scheduler_ = NULL;
+    }
+    if (dnstap_ != NULL) {
+        dnstap_->Close();
+        dnstap_ = NULL;
+    }
+    delete addressCache_;
+    // NOTE: after the context, which frees through it
+    delete memory_;
+    // NOTE: lookups hold a reference, so no record is in use anymore
+    for (size_t i = 0; i < callbackDataSlabs_.size(); ++i) {
+        delete[] callbackDataSlabs_[i];
+    }
 
     // NOTE: same cleanup as in ObjectWrap.
     {
@@ -685,7 +800,7 @@ void GNContext::ApplyOptions(Local<Object> self, Local<Value> optsV) {
         return;
     }
     if (!GNUtil::isDictionaryObject(optsV)) {
-        Local<Value> typeError = makeTypeErrorWithCode("options", GETDNS_RETURN_INVALID_PARAMETER);
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode("options", GETDNS_RETURN_INVALID_PARAMETER);
         return Nan::ThrowError(typeError);
     }
     Local<Object> selfObj = Nan::To<v8::Object>(self).ToLocalChecked();
@@ -694,13 +809,16 @@ void GNContext::ApplyOptions(Local<Object> self, Local<Value> optsV) {
     Local<Array> names = Nan::GetOwnPropertyNames(opts).ToLocalChecked();
     // check options for matching properties
     if (names->Length() > selfNames->Length()) {
-        Local<Value> typeError = makeTypeErrorWithCode("options", GETDNS_RETURN_INVALID_PARAMETER);
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode("options", GETDNS_RETURN_INVALID_PARAMETER);
         return Nan::ThrowError(typeError);
     }
     bool found = false;
     for(unsigned int i = 0; i < names->Length(); i++) {
         found = false;
         Nan::Utf8String nameVal(Nan::Get(names, i).ToLocalChecked());
+        if (isCreationOption(*nameVal)) {
+            continue;
+        }
         for(unsigned int j = 0; j < selfNames->Length(); j++) {
             Nan::Utf8String selfNameVal(Nan::Get(selfNames, j).ToLocalChecked());
             if (strcmp(*nameVal, *selfNameVal) == 0) {
@@ -709,7 +827,7 @@ void GNContext::ApplyOptions(Local<Object> self, Local<Value> optsV) {
             }
         }
         if(!found) {
-            Local<Value> typeError = makeTypeErrorWithCode(*nameVal, GETDNS_RETURN_INVALID_PARAMETER);
+            Local<Value> typeError = GNUtil::makeTypeErrorWithCode(*nameVal, GETDNS_RETURN_INVALID_PARAMETER);
             return Nan::ThrowError(typeError);
         }
     }
@@ -717,6 +835,9 @@ void GNContext::ApplyOptions(Local<Object> self, Local<Value> optsV) {
     Nan::TryCatch try_catch;
     for(unsigned int i = 0; i < names->Length(); i++) {
         Local<Value> nameVal = Nan::Get(names, i).ToLocalChecked();
+        if (isCreationOption(*Nan::Utf8String(nameVal))) {
+            continue;
+        }
         Local<Value> opt = Nan::Get(opts, nameVal).ToLocalChecked();
         Nan::Set(self, nameVal, opt);
         if (try_catch.HasCaught()) {
@@ -726,6 +847,9 @@ void GNContext::ApplyOptions(Local<Object> self, Local<Value> optsV) {
     }
 }
 
+// Context constructor, for clone
+static Nan::Persistent<Function> contextConstructor;
+
 // Module initialization
 void GNContext::Init(Local<Object> target) {
     // prepare context object template
@@ -734,8 +858,22 @@ void GNContext::Init(Local<Object> target) {
     jsContextTpl->InstanceTemplate()->SetInternalFieldCount(1);
     // Prototype
     Nan::SetPrototypeMethod(jsContextTpl, "lookup", GNContext::Lookup);
+    Nan::SetPrototypeMethod(jsContextTpl, "lookupTypes", GNContext::LookupTypes);
+    Nan::SetPrototypeMethod(jsContextTpl, "resolveRecords", GNContext::ResolveRecords);
     Nan::SetPrototypeMethod(jsContextTpl, "cancel", GNContext::Cancel);
+    Nan::SetPrototypeMethod(jsContextTpl, "cancelMany", GNContext::CancelMany);
+    Nan::SetPrototypeMethod(jsContextTpl, "cancelAll", GNContext::CancelAll);
     Nan::SetPrototypeMethod(jsContextTpl, "destroy", GNContext::Destroy);
+    Nan::SetPrototypeMethod(jsContextTpl, "memoryStats", GNContext::MemoryStats);
+    Nan::SetPrototypeMethod(jsContextTpl, "schedulerStats", GNContext::SchedulerStats);
+    Nan::SetPrototypeMethod(jsContextTpl, "dnstapStats", GNContext::DnstapStats);
+    Nan::SetPrototypeMethod(jsContextTpl, "drain", GNContext::Drain);
+    Nan::SetPrototypeMethod(jsContextTpl, "pending", GNContext::Pending);
+    Nan::SetPrototypeMethod(jsContextTpl, "pendingCount", GNContext::PendingCount);
+    Nan::SetPrototypeMethod(jsContextTpl, "clone", GNContext::Clone);
+    Nan::SetPrototypeMethod(jsContextTpl, "configure", GNContext::Configure);
+    Nan::SetPrototypeMethod(jsContextTpl, "bulkLookup", GNBulkResolver::Start);
+    Nan::SetPrototypeMethod(jsContextTpl, "reverseSweep", GNReverseSweep::Start);
     // Helpers - delegate to the same function w/ different data
     Nan::SetPrototypeTemplate(jsContextTpl, "getAddress",
         Nan::New<FunctionTemplate>(GNContext::HelperLookup, Nan::New<Integer>(GNAddress)));
@@ -743,9 +881,18 @@ void GNContext::Init(Local<Object> target) {
         Nan::New<FunctionTemplate>(GNContext::HelperLookup, Nan::New<Integer>(GNHostname)));
     Nan::SetPrototypeTemplate(jsContextTpl, "getService",
         Nan::New<FunctionTemplate>(GNContext::HelperLookup, Nan::New<Integer>(GNService)));
+    Nan::SetPrototypeMethod(jsContextTpl, "getServiceEndpoints", GNServiceEndpoints::Start);
+    Nan::SetPrototypeMethod(jsContextTpl, "warmup", GNWarmup::Start);
+    Nan::SetPrototypeMethod(jsContextTpl, "lookupAddresses", GNAddressLookup::Start);
+    Nan::SetPrototypeMethod(jsContextTpl, "clearAddressCache", GNAddressLookup::ClearCache);
+    Nan::SetPrototypeMethod(jsContextTpl, "attachRing", GNResultRing::Attach);
+    Nan::SetPrototypeMethod(jsContextTpl, "detachRing", GNResultRing::Detach);
 
     // Add the constructor
-    Nan::Set(target, Nan::New<String>("Context").ToLocalChecked(), Nan::GetFunction(jsContextTpl).ToLocalChecked());
+    Local<Function> constructor = Nan::GetFunction(jsContextTpl).ToLocalChecked();
+    contextConstructor.Reset(constructor);
+    Nan::Set(target, Nan::New<String>("Context").ToLocalChecked(), constructor);
+    Nan::SetMethod(target, "reloadZoneFiles", GNZoneFiles::Reload);
 
     // Export constants
     GNConstants::Init(target);
@@ -758,24 +905,430 @@ NAN_METHOD(GNContext::Destroy) {
         Nan::ThrowError(Nan::New<String>("Context is invalid.").ToLocalChecked());
         return;
     }
-    getdns_context_destroy(ctx->context_);
-    ctx->context_ = NULL;
+    ctx->DestroyContext();
     info.GetReturnValue().Set(Nan::True());
 }
 
+void GNContext::DestroyContext() {
+    // NOTE: cleared first, so lookups issued from the callbacks of the
+    // cancelled ones, by a bulk resolver for instance, are refused
+    getdns_context* context = context_;
+    context_ = NULL;
+    if (scheduler_) {
+        // queued lookups never reach getdns, cancel them first
+        scheduler_->Stop();
+    }
+    if (engine_) {
+        engine_->Destroy();
+        engine_ = NULL;
+    } else if (context) {
+        getdns_context_destroy(context);
+    }
+    if (ring_) {
+        // NOTE: after the cancelled ring lookups called back, whose
+        // results the workers still have to be told about
+        ring_->Notify();
+        ring_->Close();
+        ring_ = NULL;
+    }
+    if (dnstap_) {
+        // NOTE: after the lookups cancelled by the destroy called back
+        dnstap_->Close();
+        dnstap_ = NULL;
+    }
+}
+
+// Handle ctx.drain(timeout, callback): refuse new lookups, wait for the
+// pending ones, at most timeout ms when given, and destroy the context.
+// Calls back with { pending, completed, cancelled, elapsed }.
+NAN_METHOD(GNContext::Drain) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        return Nan::ThrowError(Nan::New<String>("Context is invalid.").ToLocalChecked());
+    }
+    if (info.Length() < 2 || !info[1]->IsFunction() ||
+        (!info[0]->IsUndefined() && !(info[0]->IsNumber() && Nan::To<double>(info[0]).FromJust() >= 0))) {
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode("drain", GETDNS_RETURN_INVALID_PARAMETER);
+        return Nan::ThrowError(typeError);
+    }
+    if (ctx->draining_) {
+        return Nan::ThrowError(Nan::New<String>("Context is already draining.").ToLocalChecked());
+    }
+
+    ctx->draining_ = true;
+    ctx->drainCallback_.Reset(Local<Function>::Cast(info[1]));
+    ctx->drainStarted_ = uv_now(uv_default_loop());
+    ctx->drainPending_ = ctx->pending_.size();
+    ctx->drainTimer_ = new uv_timer_t();
+    uv_timer_init(uv_default_loop(), ctx->drainTimer_);
+    ctx->drainTimer_->data = ctx;
+    // held until the drain calls back
+    ctx->Ref();
+    if (ctx->pending_.empty()) {
+        uv_timer_start(ctx->drainTimer_, GNContext::OnDrainTimer, 0, 0);
+    } else if (info[0]->IsNumber()) {
+        uv_timer_start(ctx->drainTimer_, GNContext::OnDrainTimer, (uint64_t) Nan::To<double>(info[0]).FromJust(), 0);
+    }
+    info.GetReturnValue().Set(Nan::True());
+}
+
+void GNContext::OnDrainTimer(uv_timer_t* handle) {
+    Nan::HandleScope scope;
+    GNContext* ctx = static_cast<GNContext*>(handle->data);
+    // NOTE: cleared first, so the callbacks of cancelled lookups don't restart it
+    ctx->drainTimer_ = NULL;
+    uv_close((uv_handle_t*) handle, [](uv_handle_t* closed) {
+        delete reinterpret_cast<uv_timer_t*>(closed);
+    });
+
+    size_t cancelled = ctx->pending_.size();
+    ctx->DestroyContext();
+
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New<String>("pending").ToLocalChecked(), Nan::New<Number>((double) ctx->drainPending_));
+    Nan::Set(result, Nan::New<String>("completed").ToLocalChecked(),
+             Nan::New<Number>((double) (ctx->drainPending_ - cancelled)));
+    Nan::Set(result, Nan::New<String>("cancelled").ToLocalChecked(), Nan::New<Number>((double) cancelled));
+    Nan::Set(result, Nan::New<String>("elapsed").ToLocalChecked(),
+             Nan::New<Number>((double) (uv_now(uv_default_loop()) - ctx->drainStarted_)));
+    Local<Value> argv[] = { Nan::Null(), result };
+    {
+        Nan::TryCatch try_catch;
+        ctx->drainCallback_.Call(Nan::GetCurrentContext()->Global(), 2, argv);
+        if (try_catch.HasCaught())
+            Nan::FatalException(try_catch);
+    }
+    ctx->drainCallback_.Reset();
+    ctx->Unref();
+}
+
+// Memory counters of a context created with the allocator option, or null
+NAN_METHOD(GNContext::MemoryStats) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->memory_) {
+        info.GetReturnValue().Set(Nan::Null());
+        return;
+    }
+    info.GetReturnValue().Set(ctx->memory_->Stats());
+}
+
+NAN_METHOD(GNContext::SchedulerStats) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->scheduler_) {
+        info.GetReturnValue().Set(Nan::Null());
+        return;
+    }
+    info.GetReturnValue().Set(ctx->scheduler_->Stats());
+}
+
+NAN_METHOD(GNContext::DnstapStats) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->dnstap_) {
+        info.GetReturnValue().Set(Nan::Null());
+        return;
+    }
+    info.GetReturnValue().Set(ctx->dnstap_->Stats());
+}
+
+// The upstream of all lookups of a stub context with a single upstream,
+// like those of UpstreamSelector, null otherwise: getdns doesn't tell
+// which upstream a lookup went to until it's answered.
+static Local<Value> soleUpstream(getdns_context* context) {
+    getdns_resolution_t resolution = GETDNS_RESOLUTION_RECURSING;
+    getdns_list* upstreams = NULL;
+    getdns_context_get_resolution_type(context, &resolution);
+    if (resolution == GETDNS_RESOLUTION_STUB) {
+        getdns_context_get_upstream_recursive_servers(context, &upstreams);
+    }
+    size_t count = 0;
+    getdns_dict* upstream = NULL;
+    getdns_bindata* addressData = NULL;
+    char* addressStr = NULL;
+    if (upstreams && getdns_list_get_length(upstreams, &count) == GETDNS_RETURN_GOOD && count == 1 &&
+        getdns_list_get_dict(upstreams, 0, &upstream) == GETDNS_RETURN_GOOD &&
+        getdns_dict_get_bindata(upstream, "address_data", &addressData) == GETDNS_RETURN_GOOD) {
+        addressStr = getdns_display_ip_address(addressData);
+    }
+    getdns_list_destroy(upstreams);
+    if (!addressStr) {
+        return Nan::Null();
+    }
+    Local<Value> result = Nan::New<String>(addressStr).ToLocalChecked();
+    free(addressStr);
+    return result;
+}
+
+static const char* QUERY_KIND_NAMES[] = {
+    "general",
+    "address",
+    "service",
+    "hostname"
+};
+
+// Handle ctx.pending([limit]): the pending lookups, oldest first, as
+// { transactionId, kind, name, type, age, upstream }, age in ms
+NAN_METHOD(GNContext::Pending) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        info.GetReturnValue().Set(Nan::New<Array>(0));
+        return;
+    }
+    size_t limit = ctx->pending_.size();
+    if (info.Length() > 0 && info[0]->IsNumber() && Nan::To<uint32_t>(info[0]).FromJust() < limit) {
+        limit = Nan::To<uint32_t>(info[0]).FromJust();
+    }
+
+    typedef std::pair<getdns_transaction_t, PendingLookup*> Entry;
+    std::vector<Entry> lookups(ctx->pending_.begin(), ctx->pending_.end());
+    std::partial_sort(lookups.begin(), lookups.begin() + limit, lookups.end(), [](const Entry& a, const Entry& b) {
+        return a.second->startedAt < b.second->startedAt;
+    });
+
+    Local<Value> upstream;
+    {
+        GNEngine::Pause pause(ctx->engine_);
+        upstream = soleUpstream(ctx->context_);
+    }
+    uint64_t now = uv_now(uv_default_loop());
+    Local<Array> result = Nan::New<Array>(limit);
+    for (size_t i = 0; i < limit; ++i) {
+        getdns_transaction_t transId = lookups[i].first;
+        PendingLookup* lookup = lookups[i].second;
+        Local<Object> entry = Nan::New<Object>();
+        Nan::Set(entry, Nan::New<String>("transactionId").ToLocalChecked(), GNUtil::convertToBuffer(&transId, 8));
+        Nan::Set(entry, Nan::New<String>("kind").ToLocalChecked(), Nan::New<String>(QUERY_KIND_NAMES[lookup->kind]).ToLocalChecked());
+        Nan::Set(entry, Nan::New<String>("name").ToLocalChecked(), Nan::New<String>(lookup->name).ToLocalChecked());
+        if (lookup->kind == GNEngine::GeneralQuery) {
+            Nan::Set(entry, Nan::New<String>("type").ToLocalChecked(), Nan::New<Uint32>(lookup->type));
+        } else {
+            Nan::Set(entry, Nan::New<String>("type").ToLocalChecked(), Nan::Null());
+        }
+        Nan::Set(entry, Nan::New<String>("age").ToLocalChecked(), Nan::New<Number>((double) (now - lookup->startedAt)));
+        Nan::Set(entry, Nan::New<String>("upstream").ToLocalChecked(), upstream);
+        Nan::Set(result, i, entry);
+    }
+    info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(GNContext::PendingCount) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    info.GetReturnValue().Set(Nan::New<Number>(ctx ? (double) ctx->pending_.size() : 0));
+}
+
+// Handle ctx.configure(options): check all the options before setting
+// any, then set them in one go. The upstreams are set last and only when
+// they differ from the ones set by the previous configure, so reloading
+// the same list keeps the connections. When setting an option fails the
+// previous configuration is restored.
+NAN_METHOD(GNContext::Configure) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        return Nan::ThrowError(Nan::New<String>("Context is invalid.").ToLocalChecked());
+    }
+    if (info.Length() < 1 || !GNUtil::isDictionaryObject(info[0])) {
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode("options", GETDNS_RETURN_INVALID_PARAMETER);
+        return Nan::ThrowError(typeError);
+    }
+    Local<Object> opts = Nan::To<Object>(info[0]).ToLocalChecked();
+    Local<Array> names = Nan::GetOwnPropertyNames(opts).ToLocalChecked();
+    std::vector<const SetterRef*> refs;
+    std::vector<std::string> optNames;
+    const SetterRef* upstreamRef = NULL;
+    std::string upstreamName;
+    for (uint32_t i = 0; i < names->Length(); ++i) {
+        Nan::Utf8String name(Nan::Get(names, i).ToLocalChecked());
+        const SetterRef* ref = isCreationOption(*name) ? NULL : findSetter(*name);
+        if (!ref) {
+            Local<Value> typeError = GNUtil::makeTypeErrorWithCode(*name, GETDNS_RETURN_INVALID_PARAMETER);
+            return Nan::ThrowError(typeError);
+        }
+        Local<Value> value = Nan::Get(opts, Nan::Get(names, i).ToLocalChecked()).ToLocalChecked();
+        if ((ref->kind != ValueSetter && !value->IsNumber()) || (isUpstreamSetter(ref) && !value->IsArray())) {
+            Local<Value> typeError = GNUtil::makeTypeErrorWithCode(*name, GETDNS_RETURN_INVALID_PARAMETER);
+            return Nan::ThrowError(typeError);
+        }
+        if (isUpstreamSetter(ref)) {
+            // NOTE: upstreams and upstream_recursive_servers are the same option
+            upstreamRef = ref;
+            upstreamName = *name;
+        } else {
+            refs.push_back(ref);
+            optNames.push_back(*name);
+        }
+    }
+
+    GNEngine::Pause pause(ctx->engine_);
+    getdns_dict* snapshot = getdns_context_get_api_information(ctx->context_);
+    getdns_return_t r = GETDNS_RETURN_GOOD;
+    std::string failed;
+    for (size_t i = 0; i < refs.size() && r == GETDNS_RETURN_GOOD; ++i) {
+        r = applySetter(ctx->context_, refs[i], Nan::Get(opts, Nan::New<String>(optNames[i]).ToLocalChecked()).ToLocalChecked());
+        failed = optNames[i];
+    }
+    if (r == GETDNS_RETURN_GOOD && upstreamRef) {
+        getdns_list* upstreams = NULL;
+        failed = upstreamName;
+        r = buildUpstreams(ctx->context_, Nan::Get(opts, Nan::New<String>(upstreamName).ToLocalChecked()).ToLocalChecked(), &upstreams);
+        if (r == GETDNS_RETURN_GOOD) {
+            char* json = getdns_print_json_list(upstreams, 0);
+            std::string applied = json ? json : "";
+            free(json);
+            if (applied.empty() || applied != ctx->appliedUpstreams_) {
+                r = getdns_context_set_upstream_recursive_servers(ctx->context_, upstreams);
+                ctx->appliedUpstreams_ = r == GETDNS_RETURN_GOOD ? applied : "";
+            }
+            getdns_list_destroy(upstreams);
+        }
+    }
+    if (r != GETDNS_RETURN_GOOD) {
+        getdns_dict* settings = NULL;
+        if (snapshot && getdns_dict_get_dict(snapshot, "all_context", &settings) == GETDNS_RETURN_GOOD) {
+            getdns_context_config(ctx->context_, settings);
+        }
+        ctx->appliedUpstreams_.clear();
+    }
+    getdns_dict_destroy(snapshot);
+    if (r != GETDNS_RETURN_GOOD) {
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode(failed.c_str(), r);
+        return Nan::ThrowError(typeError);
+    }
+    for (size_t i = 0; i < refs.size(); ++i) {
+        if (isRoundRobinSetter(refs[i])) {
+            ctx->warmupRoundRobin_ = false;
+        }
+    }
+}
+
+// Handle ctx.clone([options]): a context with the configuration of this
+// one, copied from the getdns settings instead of applying the options
+// again, so trust anchors and root hints are not read from disk. The
+// creation options are the same unless given, other options are applied
+// on top; a clone logs to the dnstap writer of this one, unless given
+// dnstap: null. Caches, lookups and rings are not copied.
+NAN_METHOD(GNContext::Clone) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        return Nan::ThrowError(Nan::New<String>("Context is invalid.").ToLocalChecked());
+    }
+    Local<Value> options = info.Length() > 0 ? info[0] : Nan::Undefined().As<Value>();
+    if (!options->IsUndefined() && !GNUtil::isDictionaryObject(options)) {
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode("options", GETDNS_RETURN_INVALID_PARAMETER);
+        return Nan::ThrowError(typeError);
+    }
+
+    Local<Object> creationOptions = Nan::New<Object>();
+    Local<String> threadedKey = Nan::New<String>("threaded").ToLocalChecked();
+    Local<String> allocatorKey = Nan::New<String>("allocator").ToLocalChecked();
+    Nan::Set(creationOptions, threadedKey, Nan::New<Boolean>(ctx->engine_ != NULL));
+    if (ctx->memory_) {
+        Nan::Set(creationOptions, allocatorKey, Nan::New<String>(ctx->memory_->Name()).ToLocalChecked());
+    }
+    if (ctx->scheduler_) {
+        Nan::Set(creationOptions, Nan::New<String>("scheduler").ToLocalChecked(), ctx->scheduler_->Limits());
+        Nan::Set(creationOptions, Nan::New<String>("rate_limit").ToLocalChecked(), ctx->scheduler_->RateLimit());
+    }
+    if (ctx->dnstap_) {
+        Nan::Set(creationOptions, Nan::New<String>("dnstap").ToLocalChecked(), ctx->dnstap_->Options());
+    }
+    if (!options->IsUndefined()) {
+        Local<Object> opts = Nan::To<Object>(options).ToLocalChecked();
+        for (size_t i = 0; i < NUM_CREATION_OPTIONS; ++i) {
+            Local<String> key = Nan::New<String>(CREATION_OPTIONS[i]).ToLocalChecked();
+            if (Nan::Has(opts, key).FromJust()) {
+                Nan::Set(creationOptions, key, Nan::Get(opts, key).ToLocalChecked());
+            }
+        }
+    }
+
+    // may throw for invalid creation options
+    Local<Value> argv[] = { creationOptions };
+    Nan::MaybeLocal<Object> maybeClone = Nan::NewInstance(Nan::New(contextConstructor), 1, argv);
+    if (maybeClone.IsEmpty()) {
+        return;
+    }
+    Local<Object> cloneObj = maybeClone.ToLocalChecked();
+    GNContext* clone = Nan::ObjectWrap::Unwrap<GNContext>(cloneObj);
+
+    getdns_return_t r = GETDNS_RETURN_GENERIC_ERROR;
+    {
+        GNEngine::Pause pause(ctx->engine_);
+        getdns_dict* apiInfo = getdns_context_get_api_information(ctx->context_);
+        getdns_dict* settings = NULL;
+        if (apiInfo && getdns_dict_get_dict(apiInfo, "all_context", &settings) == GETDNS_RETURN_GOOD) {
+            GNEngine::Pause clonePause(clone->engine_);
+            r = getdns_context_config(clone->context_, settings);
+        }
+        getdns_dict_destroy(apiInfo);
+    }
+    if (r != GETDNS_RETURN_GOOD) {
+        Local<Value> typeError = GNUtil::makeTypeErrorWithCode("clone", r);
+        return Nan::ThrowError(typeError);
+    }
+
+    Nan::TryCatch try_catch;
+    GNContext::ApplyOptions(cloneObj, options);
+    if (try_catch.HasCaught()) {
+        try_catch.ReThrow();
+        return;
+    }
+    info.GetReturnValue().Set(cloneObj);
+}
+
 // Create a context (new op)
 NAN_METHOD(GNContext::New) {
     if (info.IsConstructCall()) {
         if (info.Length() > 1) {
             // NOTE: duplicated in getdns.js and GNContext.cpp.
             // TODO: use new getdns.Context(...args) when not supporting node.js v4 anymore.
-            Local<Value> typeError = makeTypeErrorWithCode("Too many arguments.", GETDNS_RETURN_INVALID_PARAMETER);
+            Local<Value> typeError = GNUtil::makeTypeErrorWithCode("Too many arguments.", GETDNS_RETURN_INVALID_PARAMETER);
             return Nan::ThrowError(typeError);
         }
 
+        // Threaded contexts get attached to their engine's loop once configured
+        bool threaded = false;
+        Local<Value> allocator = Nan::Undefined();
+        Local<Value> scheduler = Nan::Undefined();
+        Local<Value> rateLimit = Nan::Undefined();
+        Local<Value> dnstap = Nan::Undefined();
+        if (info.Length() == 1 && GNUtil::isDictionaryObject(info[0])) {
+            Local<Object> opts = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+            threaded = Nan::To<bool>(Nan::Get(opts, Nan::New<String>("threaded").ToLocalChecked()).ToLocalChecked()).FromJust();
+            allocator = Nan::Get(opts, Nan::New<String>("allocator").ToLocalChecked()).ToLocalChecked();
+            scheduler = Nan::Get(opts, Nan::New<String>("scheduler").ToLocalChecked()).ToLocalChecked();
+            rateLimit = Nan::Get(opts, Nan::New<String>("rate_limit").ToLocalChecked()).ToLocalChecked();
+            dnstap = Nan::Get(opts, Nan::New<String>("dnstap").ToLocalChecked()).ToLocalChecked();
+        }
+
         // new obj
         GNContext* ctx = new GNContext();
-        getdns_return_t r = getdns_context_create(&ctx->context_, 1);
+        if (!allocator->IsUndefined()) {
+            Nan::Utf8String allocatorName(allocator);
+            if (!allocator->IsString() ||
+                (strcmp(*allocatorName, "pool") != 0 && strcmp(*allocatorName, "malloc") != 0)) {
+                delete ctx;
+                Local<Value> typeError = GNUtil::makeTypeErrorWithCode("allocator", GETDNS_RETURN_INVALID_PARAMETER);
+                return Nan::ThrowError(typeError);
+            }
+            ctx->memory_ = new GNMemoryPool(strcmp(*allocatorName, "pool") == 0);
+        }
+        if (!scheduler->IsUndefined() || !rateLimit->IsUndefined()) {
+            // throws for invalid limits
+            ctx->scheduler_ = GNScheduler::Create(ctx, scheduler, rateLimit);
+            if (!ctx->scheduler_) {
+                delete ctx;
+                return;
+            }
+        }
+        if (!dnstap->IsUndefined() && !dnstap->IsNull()) {
+            // throws for invalid options and outputs that can't be opened
+            ctx->dnstap_ = GNDnstap::Create(dnstap);
+            if (!ctx->dnstap_) {
+                delete ctx;
+                return;
+            }
+        }
+        getdns_return_t r = ctx->memory_ ? ctx->memory_->CreateContext(&ctx->context_)
+                                         : getdns_context_create(&ctx->context_, 1);
         if (r != GETDNS_RETURN_GOOD) {
             // Failed to create an underlying context
             delete ctx;
@@ -783,7 +1336,7 @@ NAN_METHOD(GNContext::New) {
         }
 
         // Attach the context to node
-        bool attached = GNUtil::attachContextToNode(ctx->context_);
+        bool attached = threaded || GNUtil::attachContextToNode(ctx->context_);
         if (!attached) {
             // Bail
             delete ctx;
@@ -803,6 +1356,12 @@ NAN_METHOD(GNContext::New) {
                 return;
             }
         }
+        if (threaded) {
+            ctx->engine_ = GNEngine::Start(ctx->context_);
+            if (!ctx->engine_) {
+                return Nan::ThrowError(Nan::New<String>("Unable to start the resolver thread.").ToLocalChecked());
+            }
+        }
         info.GetReturnValue().Set(info.This());
     } else {
         return Nan::ThrowError(Nan::New<String>("Must use new.").ToLocalChecked());
@@ -810,6 +1369,146 @@ NAN_METHOD(GNContext::New) {
     return;
 }
 
+// Lookup records are allocated this many at a time
+static const size_t CALLBACK_DATA_SLAB = 64;
+
+CallbackData* GNContext::AcquireCallbackData() {
+    if (freeCallbackData_.empty()) {
+        CallbackData* slab = new CallbackData[CALLBACK_DATA_SLAB];
+        callbackDataSlabs_.push_back(slab);
+        freeCallbackData_.reserve(freeCallbackData_.capacity() + CALLBACK_DATA_SLAB);
+        for (size_t i = 0; i < CALLBACK_DATA_SLAB; ++i) {
+            slab[i].owner = this;
+            freeCallbackData_.push_back(&slab[i]);
+        }
+    }
+    CallbackData* data = freeCallbackData_.back();
+    freeCallbackData_.pop_back();
+    data->ctx = NULL;
+    data->recordType = 0;
+    data->withTtl = false;
+    data->deadline = false;
+    return data;
+}
+
+void GNContext::ReleaseCallbackData(CallbackData* data) {
+    freeCallbackData_.push_back(data);
+}
+
+// Queries call back when the final argument is a function, and
+// otherwise settle a promise returned to the caller.
+static CallbackData* createCallbackData(GNContext* ctx, Local<Value> last) {
+    CallbackData* data = ctx ? ctx->AcquireCallbackData() : new CallbackData();
+    if (last->IsFunction()) {
+        data->callback.Reset(Local<Function>::Cast(last));
+    } else {
+        Local<Promise::Resolver> resolver = Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
+        data->resolver.Reset(resolver);
+    }
+    return data;
+}
+
+static void destroyCallbackData(CallbackData* data) {
+    data->callback.Reset();
+    data->resolver.Reset();
+    if (data->owner) {
+        data->owner->ReleaseCallbackData(data);
+    } else {
+        delete data;
+    }
+}
+
+// Promises reject with an Error carrying the fields of the error object
+static Local<Value> toError(Local<Value> errObj) {
+    Local<Object> obj = Nan::To<Object>(errObj).ToLocalChecked();
+    Local<String> msgKey = Nan::New<String>("msg").ToLocalChecked();
+    Local<Object> error = Nan::Error(Nan::To<String>(Nan::Get(obj, msgKey).ToLocalChecked()).ToLocalChecked()).As<Object>();
+    Local<Array> keys = Nan::GetOwnPropertyNames(obj).ToLocalChecked();
+    for (uint32_t i = 0; i < keys->Length(); ++i) {
+        Local<Value> key = Nan::Get(keys, i).ToLocalChecked();
+        Nan::Set(error, key, Nan::Get(obj, key).ToLocalChecked());
+    }
+    return error;
+}
+
+// The promise of a query in promise mode, undefined otherwise. Taken
+// before the query is issued, as a query answered right away, from the
+// hosts file for instance, releases its data before the issue returns.
+static Local<Value> queryPromise(CallbackData* data) {
+    if (data->resolver.IsEmpty()) {
+        return Nan::Undefined();
+    }
+    return Nan::New(data->resolver)->GetPromise();
+}
+
+// What a query method returns: the transaction id, or the promise with
+// the transaction id as its transactionId property
+static Local<Value> queryResult(Local<Value> promise, getdns_transaction_t transId) {
+    Local<Value> transIdBuffer = GNUtil::convertToBuffer(&transId, 8);
+    if (promise->IsUndefined()) {
+        return transIdBuffer;
+    }
+    Nan::Set(Nan::To<Object>(promise).ToLocalChecked(), Nan::New<String>("transactionId").ToLocalChecked(), transIdBuffer);
+    return promise;
+}
+
+// Report a query that could not be issued and free its data. Returns
+// the rejected promise in promise mode, undefined otherwise.
+static Local<Value> failQuery(CallbackData* data, const char* msg, int code) {
+    Local<Value> err = GNUtil::makeErrorObj(msg, code);
+    Local<Value> result = Nan::Undefined();
+    if (!data->callback.IsEmpty()) {
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), data->callback.GetFunction(), 1, cbArgs);
+    } else {
+        Local<Promise::Resolver> resolver = Nan::New(data->resolver);
+        resolver->Reject(Nan::GetCurrentContext(), toError(err)).FromJust();
+        result = resolver->GetPromise();
+    }
+    destroyCallbackData(data);
+    return result;
+}
+
+// Read the timeout option of a lookup, in milliseconds, 0 when not set.
+// Returns false for a timeout that is not a positive number.
+static bool readTimeout(Local<Object> options, uint64_t* timeout) {
+    Local<Value> value = Nan::Get(options, Nan::New<String>("timeout").ToLocalChecked()).ToLocalChecked();
+    *timeout = 0;
+    if (value->IsUndefined()) {
+        return true;
+    }
+    if (!value->IsNumber() || !(Nan::To<double>(value).FromJust() >= 1)) {
+        return false;
+    }
+    *timeout = (uint64_t) Nan::To<double>(value).FromJust();
+    return true;
+}
+
+// Read the priority option of a lookup, for contexts with a scheduler.
+// Returns false for an unknown priority.
+static bool readPriority(Local<Object> options, GNScheduler::Priority* priority) {
+    Local<Value> value = Nan::Get(options, Nan::New<String>("priority").ToLocalChecked()).ToLocalChecked();
+    *priority = GNScheduler::Normal;
+    return value->IsUndefined() || GNScheduler::ParsePriority(value, priority);
+}
+
+// Remove the options handled by getdns-node from the extensions
+static void removeLookupOptions(getdns_dict* extension) {
+    getdns_dict_remove_name(extension, "timeout");
+    getdns_dict_remove_name(extension, "priority");
+}
+
+// Set up the timeout of a lookup before it is issued
+void GNContext::ExpectDeadline(CallbackData* data, uint64_t timeout) {
+    if (timeout == 0) {
+        return;
+    }
+    if (!deadlines_) {
+        deadlines_ = new GNDeadlines(this);
+    }
+    data->deadline = true;
+}
+
 void GNContext::Callback(getdns_context *context,
                          getdns_callback_type_t cbType,
                          getdns_dict *response,
@@ -817,27 +1516,207 @@ void GNContext::Callback(getdns_context *context,
                          getdns_transaction_t transId) {
     Nan::HandleScope scope;
     CallbackData* data = static_cast<CallbackData*>(userArg);
+    // a lookup cancelled for its deadline timed out
+    if (data->deadline && data->ctx->deadlines_->Finish(transId) && cbType == GETDNS_CALLBACK_CANCEL) {
+        cbType = GETDNS_CALLBACK_TIMEOUT;
+    }
     // Setup the callback arguments
     Local<Value> argv[3];
-    if (cbType == GETDNS_CALLBACK_COMPLETE) {
+    if (cbType == GETDNS_CALLBACK_COMPLETE && data->recordType) {
+        argv[1] = GNRecords::shape(response, data->recordType, data->withTtl);
+        if (argv[1]->IsNull()) {
+            argv[0] = GNRecords::makeErrorObj(cbType, response);
+        } else {
+            argv[0] = Nan::Null();
+        }
+        getdns_dict_destroy(response);
+    } else if (cbType == GETDNS_CALLBACK_COMPLETE) {
         argv[0] = Nan::Null();
         argv[1] = GNUtil::convertToJSObj(response);
         getdns_dict_destroy(response);
+    } else if (data->recordType) {
+        argv[0] = GNRecords::makeErrorObj(cbType, response);
+        argv[1] = Nan::Null();
     } else {
-        argv[0] = makeErrorObj("Lookup failed.", cbType);
+        argv[0] = GNUtil::makeErrorObj("Lookup failed.", cbType);
         argv[1] = Nan::Null();
     }
-    Nan::TryCatch try_catch;
-    argv[2] = GNUtil::convertToBuffer(&transId, 8);
-    data->callback->Call(Nan::GetCurrentContext()->Global(), 3, argv);
+    if (!data->callback.IsEmpty()) {
+        Nan::TryCatch try_catch;
+        argv[2] = GNUtil::convertToBuffer(&transId, 8);
+        data->callback.Call(Nan::GetCurrentContext()->Global(), 3, argv);
 
-    if (try_catch.HasCaught())
-        Nan::FatalException(try_catch);
+        if (try_catch.HasCaught())
+            Nan::FatalException(try_catch);
+    } else {
+        // NOTE: the scope runs the microtasks, so the reactions of the
+        // promise run now instead of after some unrelated callback.
+        node::CallbackScope callbackScope(Isolate::GetCurrent(), data->ctx->handle(), { 0, 0 });
+        Local<Promise::Resolver> resolver = Nan::New(data->resolver);
+        if (argv[0]->IsNull()) {
+            resolver->Resolve(Nan::GetCurrentContext(), argv[1]).FromJust();
+        } else {
+            resolver->Reject(Nan::GetCurrentContext(), toError(argv[0])).FromJust();
+        }
+    }
+
+    GNContext* ctx = data->ctx;
+    if (ctx->memory_) {
+        ctx->memory_->Sync();
+    }
+
+    // NOTE: the record goes back to the context before it is unrefed
+    destroyCallbackData(data);
+    ctx->Unref();
+}
+
+getdns_return_t GNContext::General(const char* name, uint16_t type, getdns_dict* extensions,
+                                   void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                                   GNScheduler::Priority priority) {
+    return Track(GNEngine::GeneralQuery, name, type, NULL, extensions, userArg, transId, callback, priority);
+}
+
+getdns_return_t GNContext::Address(const char* name, getdns_dict* extensions,
+                                   void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                                   GNScheduler::Priority priority) {
+    return Track(GNEngine::AddressQuery, name, 0, NULL, extensions, userArg, transId, callback, priority);
+}
+
+getdns_return_t GNContext::Service(const char* name, getdns_dict* extensions,
+                                   void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                                   GNScheduler::Priority priority) {
+    return Track(GNEngine::ServiceQuery, name, 0, NULL, extensions, userArg, transId, callback, priority);
+}
 
-    // Unref
-    data->ctx->Unref();
-    delete data->callback;
-    delete data;
+getdns_return_t GNContext::Hostname(getdns_dict* address, getdns_dict* extensions,
+                                    void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                                    GNScheduler::Priority priority) {
+    return Track(GNEngine::HostnameQuery, NULL, 0, address, extensions, userArg, transId, callback, priority);
+}
+
+getdns_return_t GNContext::Track(GNEngine::QueryKind kind, const char* name, uint16_t type,
+                                 getdns_dict* address, getdns_dict* extensions,
+                                 void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                                 GNScheduler::Priority priority) {
+    if (draining_ || !context_) {
+        // draining, or being destroyed
+        return GETDNS_RETURN_BAD_CONTEXT;
+    }
+    PendingLookup* lookup = new PendingLookup();
+    lookup->ctx = this;
+    lookup->userArg = userArg;
+    lookup->callback = callback;
+    lookup->kind = kind;
+    lookup->type = type;
+    lookup->startedAt = uv_now(uv_default_loop());
+    if (name) {
+        lookup->name = name;
+    } else {
+        getdns_bindata* addressData = NULL;
+        if (address && getdns_dict_get_bindata(address, "address_data", &addressData) == GETDNS_RETURN_GOOD) {
+            char* addressStr = getdns_display_ip_address(addressData);
+            if (addressStr) {
+                lookup->name = addressStr;
+                free(addressStr);
+            }
+        }
+    }
+
+    // NOTE: saved, as a lookup that completes right away may start others
+    PendingLookup* outer = tracking_;
+    bool outerDone = trackingDone_;
+    tracking_ = lookup;
+    trackingDone_ = false;
+    getdns_return_t r = scheduler_
+        ? scheduler_->Submit(kind, name, type, address, extensions, lookup, transId, GNContext::TrackedCallback, priority)
+        : Issue(kind, name, type, address, extensions, lookup, transId, GNContext::TrackedCallback);
+    bool done = trackingDone_;
+    tracking_ = outer;
+    trackingDone_ = outerDone;
+
+    if (done) {
+        // called back before the transaction id was known, and freed
+        return r;
+    }
+    if (r != GETDNS_RETURN_GOOD) {
+        delete lookup;
+        return r;
+    }
+    pending_[*transId] = lookup;
+    return r;
+}
+
+void GNContext::TrackedCallback(getdns_context* context,
+                                getdns_callback_type_t cbType,
+                                getdns_dict* response,
+                                void* userArg,
+                                getdns_transaction_t transId) {
+    PendingLookup* lookup = static_cast<PendingLookup*>(userArg);
+    GNContext* ctx = lookup->ctx;
+    if (lookup == ctx->tracking_) {
+        ctx->trackingDone_ = true;
+    } else {
+        ctx->pending_.erase(transId);
+    }
+    if (ctx->dnstap_ && response) {
+        // NOTE: before the callback, which destroys the response
+        ctx->dnstap_->Log(response, lookup->kind, lookup->name, lookup->type,
+                          uv_now(uv_default_loop()) - lookup->startedAt);
+    }
+    getdns_callback_t callback = lookup->callback;
+    void* arg = lookup->userArg;
+    delete lookup;
+    callback(context, cbType, response, arg, transId);
+    if (ctx->drainTimer_ && ctx->pending_.empty()) {
+        // NOTE: the context can't be destroyed from one of its callbacks
+        uv_timer_start(ctx->drainTimer_, GNContext::OnDrainTimer, 0, 0);
+    }
+}
+
+getdns_return_t GNContext::CancelCallback(getdns_transaction_t transId) {
+    if (scheduler_) {
+        return scheduler_->Cancel(transId);
+    }
+    return CancelIssued(transId);
+}
+
+getdns_return_t GNContext::Issue(GNEngine::QueryKind kind, const char* name, uint16_t type,
+                                 getdns_dict* address, getdns_dict* extensions,
+                                 void* userArg, getdns_transaction_t* transId, getdns_callback_t callback) {
+    if (engine_) {
+        return engine_->Submit(kind, name, type, address, extensions, userArg, transId, callback);
+    }
+    switch (kind) {
+        case GNEngine::AddressQuery:
+            return getdns_address(context_, name, extensions, userArg, transId, callback);
+        case GNEngine::ServiceQuery:
+            return getdns_service(context_, name, extensions, userArg, transId, callback);
+        case GNEngine::HostnameQuery:
+            return getdns_hostname(context_, address, extensions, userArg, transId, callback);
+        default:
+            return getdns_general(context_, name, type, extensions, userArg, transId, callback);
+    }
+}
+
+getdns_return_t GNContext::CancelIssued(getdns_transaction_t transId) {
+    if (engine_) {
+        return engine_->Cancel(transId) ? GETDNS_RETURN_GOOD : GETDNS_RETURN_UNKNOWN_TRANSACTION;
+    }
+    return getdns_cancel_callback(context_, transId);
+}
+
+size_t GNContext::CancelCallbacks(const std::vector<getdns_transaction_t>& transIds) {
+    if (engine_ && !scheduler_) {
+        return engine_->CancelMany(transIds);
+    }
+    size_t cancelled = 0;
+    for (size_t i = 0; i < transIds.size(); ++i) {
+        // NOTE: calls back right away, which may destroy the context
+        if (context_ && CancelCallback(transIds[i]) == GETDNS_RETURN_GOOD) {
+            ++cancelled;
+        }
+    }
+    return cancelled;
 }
 
 // Cancel a req.  Expect it to be a transaction id as a buffer
@@ -854,13 +1733,198 @@ NAN_METHOD(GNContext::Cancel) {
     }
     uint64_t transId;
     memcpy(&transId, node::Buffer::Data(info[0]), 8);
-    getdns_return_t r = getdns_cancel_callback(ctx->context_, transId);
+    getdns_return_t r = ctx->CancelCallback(transId);
     info.GetReturnValue().Set(r == GETDNS_RETURN_GOOD ? Nan::True() : Nan::False());
 }
 
+// Cancel an array of transaction ids in one call, returns how many were
+// cancelled. Ids of finished lookups are ignored.
+NAN_METHOD(GNContext::CancelMany) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_ || info.Length() < 1 || !info[0]->IsArray()) {
+        info.GetReturnValue().Set(Nan::New<Uint32>(0));
+        return;
+    }
+    // NOTE: collected first, callbacks of cancelled lookups may run JS
+    Local<Array> ids = Local<Array>::Cast(info[0]);
+    uint32_t length = ids->Length();
+    std::vector<getdns_transaction_t> transIds;
+    transIds.reserve(length);
+    for (uint32_t i = 0; i < length; ++i) {
+        Local<Value> id = Nan::Get(ids, i).ToLocalChecked();
+        if (!node::Buffer::HasInstance(id) || node::Buffer::Length(id) != 8) {
+            continue;
+        }
+        getdns_transaction_t transId;
+        memcpy(&transId, node::Buffer::Data(id), 8);
+        transIds.push_back(transId);
+    }
+    info.GetReturnValue().Set(Nan::New<Uint32>((uint32_t) ctx->CancelCallbacks(transIds)));
+}
+
+// Cancel all lookups started from JavaScript that didn't call back yet,
+// returns how many were cancelled.
+NAN_METHOD(GNContext::CancelAll) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        info.GetReturnValue().Set(Nan::New<Uint32>(0));
+        return;
+    }
+    std::vector<getdns_transaction_t> transIds;
+    std::unordered_map<getdns_transaction_t, PendingLookup*>::iterator it;
+    for (it = ctx->pending_.begin(); it != ctx->pending_.end(); ++it) {
+        // NOTE: only lookups started from JavaScript, not those of bulk lookups, sweeps, etc.
+        if (it->second->callback == GNContext::Callback || it->second->callback == GNContext::MultiTypeCallback) {
+            transIds.push_back(it->first);
+        }
+    }
+    info.GetReturnValue().Set(Nan::New<Uint32>((uint32_t) ctx->CancelCallbacks(transIds)));
+}
+
 // Handle getdns general
 NAN_METHOD(GNContext::Lookup) {
-    // name, type, and callback are required
+    // name and type are required, without a callback a promise is returned
+    if (info.Length() < 2 || (info.Length() < 3 && info[info.Length() - 1]->IsFunction())) {
+        return Nan::ThrowTypeError(Nan::New<String>("At least 3 arguments are required.").ToLocalChecked());
+    }
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    CallbackData* data = createCallbackData(ctx, info[info.Length() - 1]);
+    if (!ctx || !ctx->context_) {
+        info.GetReturnValue().Set(failQuery(data, "Context is invalid", GETDNS_RETURN_GENERIC_ERROR));
+        return;
+    }
+    // take first arg and make it a string
+    Nan::Utf8String name(info[0]);
+    // second arg must be a number
+    if (!info[1]->IsNumber()) {
+        info.GetReturnValue().Set(failQuery(data, "Second argument must be a number", GETDNS_RETURN_INVALID_PARAMETER));
+        return;
+    }
+    uint16_t type = (uint16_t) Nan::To<uint32_t>(info[1]).FromJust();
+
+    // optional third arg is an object, timeout and priority are ours and not extensions
+    getdns_dict* extension = NULL;
+    uint64_t timeout = 0;
+    GNScheduler::Priority priority = GNScheduler::Normal;
+    if (info.Length() > 2 && info[2]->IsObject() && !info[2]->IsFunction()) {
+        Local<Object> extObj = Nan::To<v8::Object>(info[2]).ToLocalChecked();
+        if (!readTimeout(extObj, &timeout)) {
+            info.GetReturnValue().Set(failQuery(data, "Invalid timeout", GETDNS_RETURN_INVALID_PARAMETER));
+            return;
+        }
+        if (!readPriority(extObj, &priority)) {
+            info.GetReturnValue().Set(failQuery(data, "Invalid priority", GETDNS_RETURN_INVALID_PARAMETER));
+            return;
+        }
+        extension = GNUtil::convertToDict(extObj);
+        removeLookupOptions(extension);
+    }
+
+    data->ctx = ctx;
+    ctx->ExpectDeadline(data, timeout);
+    Local<Value> promise = queryPromise(data);
+    ctx->Ref();
+
+    // issue a query
+    getdns_transaction_t transId;
+    getdns_return_t r = ctx->General(*name, type,
+                                     extension, data, &transId,
+                                     GNContext::Callback, priority);
+    if (r != GETDNS_RETURN_GOOD) {
+        // fail
+        ctx->Unref();
+        info.GetReturnValue().Set(failQuery(data, "Error issuing query", r));
+        return;
+    }
+    // done.
+    Local<Value> result = queryResult(promise, transId);
+    // NOTE: not for a lookup that already called back
+    if (timeout && ctx->pending_.count(transId)) {
+        ctx->deadlines_->Add(transId, timeout);
+    }
+    info.GetReturnValue().Set(result);
+}
+
+// Record the outcome of one type and pass it to onEach, if given.
+static void multiTypeRecord(MultiTypeData* multi, uint16_t type, int errCode, getdns_dict* response) {
+    Nan::HandleScope scope;
+    Local<Value> result = Nan::Null();
+    Local<Value> err = Nan::Null();
+    if (errCode == GETDNS_CALLBACK_COMPLETE) {
+        result = GNUtil::convertToJSObj(response);
+    } else {
+        Nan::Set(Nan::New(multi->failures), type, Nan::New<Integer>(errCode));
+        if (!multi->firstError) {
+            multi->firstError = errCode;
+        }
+        err = GNUtil::makeErrorObj("Lookup failed.", errCode);
+    }
+    Nan::Set(Nan::New(multi->results), type, result);
+
+    if (multi->onEach) {
+        Nan::TryCatch try_catch;
+        Local<Value> argv[] = { err, result, Nan::New<Integer>(type) };
+        multi->onEach->Call(Nan::GetCurrentContext()->Global(), 3, argv);
+        if (try_catch.HasCaught())
+            Nan::FatalException(try_catch);
+    }
+}
+
+// Drop one outstanding count and make the final callback after the last one.
+// Returns true when multi is gone.
+static bool multiTypeRelease(MultiTypeData* multi) {
+    if (--multi->remaining > 0) {
+        return false;
+    }
+    Nan::HandleScope scope;
+    Local<Value> argv[2];
+    if (multi->firstError) {
+        Local<Object> errObj = GNUtil::makeErrorObj("Lookup failed.", multi->firstError).As<Object>();
+        Nan::Set(errObj, Nan::New<String>("types").ToLocalChecked(), Nan::New(multi->failures));
+        argv[0] = errObj;
+    } else {
+        argv[0] = Nan::Null();
+    }
+    argv[1] = Nan::New(multi->results);
+
+    Nan::TryCatch try_catch;
+    multi->callback->Call(Nan::GetCurrentContext()->Global(), 2, argv);
+    if (try_catch.HasCaught())
+        Nan::FatalException(try_catch);
+
+    multi->results.Reset();
+    multi->failures.Reset();
+    if (multi->extension) {
+        getdns_dict_destroy(multi->extension);
+    }
+    delete multi->callback;
+    delete multi->onEach;
+    delete multi;
+    return true;
+}
+
+void GNContext::MultiTypeCallback(getdns_context *context,
+                                  getdns_callback_type_t cbType,
+                                  getdns_dict *response,
+                                  void *userArg,
+                                  getdns_transaction_t transId) {
+    MultiTypeQuery* query = static_cast<MultiTypeQuery*>(userArg);
+    MultiTypeData* multi = query->multi;
+    GNContext* ctx = multi->ctx;
+    multiTypeRecord(multi, query->type, cbType, response);
+    delete query;
+    if (response) {
+        getdns_dict_destroy(response);
+    }
+    if (multiTypeRelease(multi)) {
+        ctx->Unref();
+    }
+}
+
+// Issue queries for several types of one name in parallel
+// lookupTypes(name, types, [extensions], [onEach], callback)
+NAN_METHOD(GNContext::LookupTypes) {
+    // name, types, and callback are required
     if (info.Length() < 3) {
         return Nan::ThrowTypeError(Nan::New<String>("At least 3 arguments are required.").ToLocalChecked());
     }
@@ -872,109 +1936,219 @@ NAN_METHOD(GNContext::Lookup) {
     Local<Function> localCb = Local<Function>::Cast(last);
     GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
     if (!ctx || !ctx->context_) {
-        Local<Value> err = makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
+        Local<Value> err = GNUtil::makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
         Local<Value> cbArgs[] = { err };
         Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
         return;
     }
     // take first arg and make it a string
     Nan::Utf8String name(info[0]);
-    // second arg must be a number
-    if (!info[1]->IsNumber()) {
-        Local<Value> err = makeErrorObj("Second argument must be a number", GETDNS_RETURN_INVALID_PARAMETER);
+    // second arg must be a non-empty array of numbers
+    if (!info[1]->IsArray() || Local<Array>::Cast(info[1])->Length() == 0) {
+        Local<Value> err = GNUtil::makeErrorObj("Second argument must be an array of types", GETDNS_RETURN_INVALID_PARAMETER);
         Local<Value> cbArgs[] = { err };
         Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
         return;
     }
-    uint16_t type = (uint16_t) Nan::To<uint32_t>(info[1]).FromJust();
+    Local<Array> typeList = Local<Array>::Cast(info[1]);
+    uint32_t numTypes = typeList->Length();
+    for (uint32_t i = 0; i < numTypes; ++i) {
+        if (!Nan::Get(typeList, i).ToLocalChecked()->IsNumber()) {
+            Local<Value> err = GNUtil::makeErrorObj("Second argument must be an array of types", GETDNS_RETURN_INVALID_PARAMETER);
+            Local<Value> cbArgs[] = { err };
+            Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+            return;
+        }
+    }
 
-    // optional third arg is an object
+    // optional extensions and per type callback before the final callback
     getdns_dict* extension = NULL;
-    if (info.Length() > 3 && info[2]->IsObject()) {
-        extension = GNUtil::convertToDict(Nan::To<v8::Object>(info[2]).ToLocalChecked());
+    Local<Value> onEach;
+    for (int i = 2; i < info.Length() - 1; ++i) {
+        if (info[i]->IsFunction()) {
+            onEach = info[i];
+        } else if (info[i]->IsObject() && !extension) {
+            extension = GNUtil::convertToDict(Nan::To<v8::Object>(info[i]).ToLocalChecked());
+        }
+    }
+
+    MultiTypeData* multi = new MultiTypeData();
+    multi->callback = new Nan::Callback(localCb);
+    multi->onEach = onEach.IsEmpty() ? NULL : new Nan::Callback(Local<Function>::Cast(onEach));
+    multi->results.Reset(Nan::New<Object>());
+    multi->failures.Reset(Nan::New<Object>());
+    multi->extension = extension;
+    multi->ctx = ctx;
+    // hold one extra count while issuing, in case queries finish synchronously
+    multi->remaining = numTypes + 1;
+    multi->firstError = 0;
+    ctx->Ref();
+
+    Local<Array> transIds = Nan::New<Array>(numTypes);
+    for (uint32_t i = 0; i < numTypes; ++i) {
+        MultiTypeQuery* query = new MultiTypeQuery();
+        query->multi = multi;
+        query->type = (uint16_t) Nan::To<uint32_t>(Nan::Get(typeList, i).ToLocalChecked()).FromJust();
+
+        getdns_transaction_t transId;
+        getdns_return_t r = ctx->General(*name, query->type,
+                                         extension, query, &transId,
+                                         GNContext::MultiTypeCallback);
+        if (r != GETDNS_RETURN_GOOD) {
+            // can't finish here, the issuing count is still held
+            multiTypeRecord(multi, query->type, r, NULL);
+            multiTypeRelease(multi);
+            delete query;
+            Nan::Set(transIds, i, Nan::Null());
+        } else {
+            Nan::Set(transIds, i, GNUtil::convertToBuffer(&transId, 8));
+        }
+    }
+    // release the issuing count; finishes here if everything already completed
+    if (multiTypeRelease(multi)) {
+        ctx->Unref();
+    }
+    // done. return the transaction ids, one per type
+    info.GetReturnValue().Set(transIds);
+}
+
+// Handle ctx.resolveRecords(name, type, [options], [callback]), the
+// lookup behind the Resolver class. options.ttl adds the ttl to A/AAAA
+// records and options.extensions are the usual extensions. A PTR lookup
+// of an IP address does a reverse lookup, like getHostname.
+NAN_METHOD(GNContext::ResolveRecords) {
+    if (info.Length() < 2 || (info.Length() < 3 && info[info.Length() - 1]->IsFunction())) {
+        return Nan::ThrowTypeError(Nan::New<String>("At least 3 arguments are required.").ToLocalChecked());
+    }
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    CallbackData* data = createCallbackData(ctx, info[info.Length() - 1]);
+    if (!ctx || !ctx->context_) {
+        info.GetReturnValue().Set(failQuery(data, "Context is invalid", GETDNS_RETURN_GENERIC_ERROR));
+        return;
+    }
+    Nan::Utf8String name(info[0]);
+    uint16_t type = info[1]->IsNumber() ? (uint16_t) Nan::To<uint32_t>(info[1]).FromJust() : 0;
+    if (!GNRecords::isSupported(type)) {
+        info.GetReturnValue().Set(failQuery(data, "Unsupported record type", GETDNS_RETURN_INVALID_PARAMETER));
+        return;
+    }
+
+    bool withTtl = false;
+    uint64_t timeout = 0;
+    GNScheduler::Priority priority = GNScheduler::Normal;
+    getdns_dict* extension = NULL;
+    if (info.Length() > 2 && info[2]->IsObject() && !info[2]->IsFunction()) {
+        Local<Object> options = Nan::To<v8::Object>(info[2]).ToLocalChecked();
+        if (!readTimeout(options, &timeout)) {
+            info.GetReturnValue().Set(failQuery(data, "Invalid timeout", GETDNS_RETURN_INVALID_PARAMETER));
+            return;
+        }
+        if (!readPriority(options, &priority)) {
+            info.GetReturnValue().Set(failQuery(data, "Invalid priority", GETDNS_RETURN_INVALID_PARAMETER));
+            return;
+        }
+        withTtl = Nan::To<bool>(Nan::Get(options, Nan::New<String>("ttl").ToLocalChecked()).ToLocalChecked()).FromJust();
+        Local<Value> extensions = Nan::Get(options, Nan::New<String>("extensions").ToLocalChecked()).ToLocalChecked();
+        if (extensions->IsObject()) {
+            extension = GNUtil::convertToDict(Nan::To<v8::Object>(extensions).ToLocalChecked());
+        }
     }
 
-    // create callback data
-    CallbackData *data = new CallbackData();
-    data->callback = new Nan::Callback(localCb);
     data->ctx = ctx;
+    data->recordType = type;
+    data->withTtl = withTtl;
+    ctx->ExpectDeadline(data, timeout);
+    Local<Value> promise = queryPromise(data);
     ctx->Ref();
 
-    // issue a query
     getdns_transaction_t transId;
-    getdns_return_t r = getdns_general(ctx->context_, *name, type,
-                                       extension, data, &transId,
-                                       GNContext::Callback);
+    getdns_return_t r = GETDNS_RETURN_GOOD;
+    getdns_dict* ip = type == GETDNS_RRTYPE_PTR ? getdns_util_create_ip(*name) : NULL;
+    if (ip) {
+        r = ctx->Hostname(ip, extension,
+                          data, &transId, GNContext::Callback, priority);
+        getdns_dict_destroy(ip);
+    } else {
+        r = ctx->General(*name, type,
+                         extension, data, &transId,
+                         GNContext::Callback, priority);
+    }
+    if (extension) {
+        getdns_dict_destroy(extension);
+    }
+
     if (r != GETDNS_RETURN_GOOD) {
         // fail
-        delete data->callback;
-        data->ctx->Unref();
-        delete data;
-
-        Local<Value> err = makeErrorObj("Error issuing query", r);
-        Local<Value> cbArgs[] = { err };
-        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        ctx->Unref();
+        info.GetReturnValue().Set(failQuery(data, "Error issuing query", r));
         return;
     }
     // done.
-    info.GetReturnValue().Set(GNUtil::convertToBuffer(&transId, 8));
+    Local<Value> result = queryResult(promise, transId);
+    // NOTE: not for a lookup that already called back
+    if (timeout && ctx->pending_.count(transId)) {
+        ctx->deadlines_->Add(transId, timeout);
+    }
+    info.GetReturnValue().Set(result);
 }
 
 // Common function to handle getdns_address/service/hostname
 NAN_METHOD(GNContext::HelperLookup) {
     // first argument is a string
-    // last argument must be a callback
     // optional argument of extensions
-    // name, type, and callback are required
-    if (info.Length() < 2) {
+    // optional last argument is a callback, a promise is returned without one
+    if (info.Length() < 1 || (info.Length() < 2 && info[info.Length() - 1]->IsFunction())) {
         return Nan::ThrowTypeError(Nan::New<String>("At least 2 arguments are required.").ToLocalChecked());
     }
-    // last arg must be a callback
-    Local<Value> last = info[info.Length() - 1];
-    if (!last->IsFunction()) {
-        return Nan::ThrowTypeError(Nan::New<String>("Final argument must be a function.").ToLocalChecked());
-    }
-    Local<Function> localCb = Local<Function>::Cast(last);
     GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    CallbackData* data = createCallbackData(ctx, info[info.Length() - 1]);
     if (!ctx || !ctx->context_) {
-        Local<Value> err = makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
-        Local<Value> cbArgs[] = { err };
-        Nan::Call(localCb, Nan::GetCurrentContext()->Global(), 1, cbArgs);
+        info.GetReturnValue().Set(failQuery(data, "Context is invalid", GETDNS_RETURN_GENERIC_ERROR));
         return;
     }
     // take first arg and make it a string
     Nan::Utf8String name(info[0]);
 
-    // 2nd arg could be extensions
-    // optional third arg is an object
+    // 2nd arg could be extensions, timeout and priority are ours and not extensions
     getdns_dict* extension = NULL;
-    if (info.Length() > 2 && info[1]->IsObject()) {
-        extension = GNUtil::convertToDict(Nan::To<v8::Object>(info[1]).ToLocalChecked());
+    uint64_t timeout = 0;
+    GNScheduler::Priority priority = GNScheduler::Normal;
+    if (info.Length() > 1 && info[1]->IsObject() && !info[1]->IsFunction()) {
+        Local<Object> extObj = Nan::To<v8::Object>(info[1]).ToLocalChecked();
+        if (!readTimeout(extObj, &timeout)) {
+            info.GetReturnValue().Set(failQuery(data, "Invalid timeout", GETDNS_RETURN_INVALID_PARAMETER));
+            return;
+        }
+        if (!readPriority(extObj, &priority)) {
+            info.GetReturnValue().Set(failQuery(data, "Invalid priority", GETDNS_RETURN_INVALID_PARAMETER));
+            return;
+        }
+        extension = GNUtil::convertToDict(extObj);
+        removeLookupOptions(extension);
     }
 
     // figure out what called us
     uint32_t funcType = Nan::To<uint32_t>(info.Data()).FromJust();
-    // create callback data
-    CallbackData *data = new CallbackData();
-    data->callback = new Nan::Callback(localCb);
     data->ctx = ctx;
+    ctx->ExpectDeadline(data, timeout);
+    Local<Value> promise = queryPromise(data);
     ctx->Ref();
 
     getdns_transaction_t transId;
     getdns_return_t r = GETDNS_RETURN_GOOD;
     if (funcType == GNAddress) {
-        r = getdns_address(ctx->context_, *name, extension,
-                           data, &transId, GNContext::Callback);
+        r = ctx->Address(*name, extension,
+                         data, &transId, GNContext::Callback, priority);
     } else if(funcType == GNService) {
-        r = getdns_service(ctx->context_, *name, extension,
-                           data, &transId, GNContext::Callback);
+        r = ctx->Service(*name, extension,
+                         data, &transId, GNContext::Callback, priority);
     } else {
         // hostname
         // convert to a dictionary..
         getdns_dict* ip = getdns_util_create_ip(*name);
         if (ip) {
-            r = getdns_hostname(ctx->context_, ip, extension,
-                                data, &transId, GNContext::Callback);
+            r = ctx->Hostname(ip, extension,
+                              data, &transId, GNContext::Callback, priority);
             getdns_dict_destroy(ip);
         } else {
             r = GETDNS_RETURN_GENERIC_ERROR;
@@ -983,17 +2157,17 @@ NAN_METHOD(GNContext::HelperLookup) {
 
     if (r != GETDNS_RETURN_GOOD) {
         // fail
-        delete data->callback;
-        data->ctx->Unref();
-        delete data;
-
-        Local<Value> err = makeErrorObj("Error issuing query", r);
-        Local<Value> cbArgs[] = { err };
-        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        ctx->Unref();
+        info.GetReturnValue().Set(failQuery(data, "Error issuing query", r));
         return;
     }
-    // done. return as buffer
-    info.GetReturnValue().Set(GNUtil::convertToBuffer(&transId, 8));
+    // done.
+    Local<Value> result = queryResult(promise, transId);
+    // NOTE: not for a lookup that already called back
+    if (timeout && ctx->pending_.count(transId)) {
+        ctx->deadlines_->Add(transId, timeout);
+    }
+    info.GetReturnValue().Set(result);
 }
 
 // Init the module
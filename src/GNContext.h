@@ -32,13 +32,45 @@
 #include <nan.h>
 #include <getdns/getdns.h>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GNAddressLookup.h"
+#include "GNEngine.h"
+#include "GNMemoryPool.h"
+#include "GNResultRing.h"
+#include "GNDeadlines.h"
+#include "GNScheduler.h"
+#include "GNDnstap.h"
+
+// Record of a lookup issued by the context, see GNContext.cpp
+struct CallbackData;
+
+// Record of a lookup the context waits for, see GNContext::Track
+struct PendingLookup;
+
 // Getdns Context wrapper for Node
 class GNContext : public Nan::ObjectWrap {
 public:
     // Node module initializer
     static void Init(v8::Local<v8::Object> target);
 
+    // Lookup records are recycled per context, to be handed out again
+    // once released, and only allocated in slabs while none are free
+    CallbackData* AcquireCallbackData();
+    void ReleaseCallbackData(CallbackData* data);
+
 private:
+    friend class GNBulkResolver;
+    friend class GNReverseSweep;
+    friend class GNServiceEndpoints;
+    friend class GNAddressLookup;
+    friend class GNResultRing;
+    friend class GNWarmup;
+    friend class GNDeadlines;
+    friend class GNScheduler;
+
     GNContext();
     ~GNContext();
 
@@ -52,6 +84,18 @@ private:
     static NAN_METHOD(Lookup);
     static NAN_METHOD(HelperLookup);
     static NAN_METHOD(Cancel);
+    static NAN_METHOD(CancelMany);
+    static NAN_METHOD(CancelAll);
+    static NAN_METHOD(LookupTypes);
+    static NAN_METHOD(ResolveRecords);
+    static NAN_METHOD(MemoryStats);
+    static NAN_METHOD(Clone);
+    static NAN_METHOD(Configure);
+    static NAN_METHOD(SchedulerStats);
+    static NAN_METHOD(DnstapStats);
+    static NAN_METHOD(Drain);
+    static NAN_METHOD(Pending);
+    static NAN_METHOD(PendingCount);
 
     static void InitProperties(v8::Local<v8::Object> self);
     static NAN_GETTER(GetContextValue);
@@ -63,10 +107,104 @@ private:
                          getdns_dict *response,
                          void *userArg,
                          getdns_transaction_t this_transaction_id);
+    static void MultiTypeCallback(getdns_context *this_context,
+                                  getdns_callback_type_t cbType,
+                                  getdns_dict *response,
+                                  void *userArg,
+                                  getdns_transaction_t this_transaction_id);
+
+    // Prepare a lookup with a timeout option before it is issued
+    void ExpectDeadline(CallbackData* data, uint64_t timeout);
+
+    // Issue lookups like getdns_general/address/service/hostname and
+    // cancel them like getdns_cancel_callback. Threaded contexts hand
+    // them to the engine, callbacks always run on the main thread. With
+    // a scheduler, lookups over its limits wait for their turn.
+    getdns_return_t General(const char* name, uint16_t type, getdns_dict* extensions,
+                            void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                            GNScheduler::Priority priority = GNScheduler::Normal);
+    getdns_return_t Address(const char* name, getdns_dict* extensions,
+                            void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                            GNScheduler::Priority priority = GNScheduler::Normal);
+    getdns_return_t Service(const char* name, getdns_dict* extensions,
+                            void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                            GNScheduler::Priority priority = GNScheduler::Normal);
+    getdns_return_t Hostname(getdns_dict* address, getdns_dict* extensions,
+                             void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                             GNScheduler::Priority priority = GNScheduler::Normal);
+    getdns_return_t CancelCallback(getdns_transaction_t transId);
+    // Cancel many lookups, returns how many were cancelled
+    size_t CancelCallbacks(const std::vector<getdns_transaction_t>& transIds);
+
+    // Register a lookup in pending_ and hand it to the scheduler or Issue
+    getdns_return_t Track(GNEngine::QueryKind kind, const char* name, uint16_t type,
+                          getdns_dict* address, getdns_dict* extensions,
+                          void* userArg, getdns_transaction_t* transId, getdns_callback_t callback,
+                          GNScheduler::Priority priority);
+    static void TrackedCallback(getdns_context* context,
+                                getdns_callback_type_t cbType,
+                                getdns_dict* response,
+                                void* userArg,
+                                getdns_transaction_t transId);
+
+    // Destroy the getdns context, cancelling its lookups
+    void DestroyContext();
+    static void OnDrainTimer(uv_timer_t* handle);
+
+    // Issue and cancel lookups on the engine or getdns, past the scheduler
+    getdns_return_t Issue(GNEngine::QueryKind kind, const char* name, uint16_t type,
+                          getdns_dict* address, getdns_dict* extensions,
+                          void* userArg, getdns_transaction_t* transId, getdns_callback_t callback);
+    getdns_return_t CancelIssued(getdns_transaction_t transId);
 
     // Underlying getdns_context
     struct getdns_context* context_;
 
+    // Answers of lookupAddresses, created on first use
+    GNAddressLookup::Cache* addressCache_;
+
+    // Thread running the context, NULL unless created with threaded: true
+    GNEngine* engine_;
+
+    // Admission control, NULL unless created with the scheduler option
+    GNScheduler* scheduler_;
+
+    // Query logging, NULL unless created with the dnstap option
+    GNDnstap* dnstap_;
+
+    // SharedArrayBuffer channels, created on first attachRing
+    GNResultRing* ring_;
+
+    // Allocator of the context, NULL unless created with the allocator option
+    GNMemoryPool* memory_;
+
+    // Timeouts of single lookups, created on the first one
+    GNDeadlines* deadlines_;
+
+    // Warmups running, and whether they turned round robin upstreams on;
+    // setting the option meanwhile clears this, so the user's value stays
+    size_t warmups_;
+    bool warmupRoundRobin_;
+
+    // Lookups that didn't call back yet, and the one being issued
+    std::unordered_map<getdns_transaction_t, PendingLookup*> pending_;
+    PendingLookup* tracking_;
+    bool trackingDone_;
+
+    // Set by drain, which refuses new lookups and destroys the context
+    // once the pending ones are done or the timer fires
+    bool draining_;
+    uv_timer_t* drainTimer_;
+    Nan::Callback drainCallback_;
+    uint64_t drainStarted_;
+    size_t drainPending_;
+
+    // Free lookup records, and the slabs they were allocated in
+    std::vector<CallbackData*> freeCallbackData_;
+    std::vector<CallbackData*> callbackDataSlabs_;
+
+    // Upstreams set by the last configure, as JSON, empty when unknown
+    std::string appliedUpstreams_;
 };
 
 #endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNDeadlines.h"
+#include "GNContext.h"
+
+GNDeadlines::GNDeadlines(GNContext* ctx) : ctx_(ctx), armed_(0) {
+    uv_timer_init(uv_default_loop(), &timer_);
+    timer_.data = this;
+    // NOTE: the lookups keep the loop alive, not their deadlines
+    uv_unref((uv_handle_t*) &timer_);
+}
+
+void GNDeadlines::Add(getdns_transaction_t transId, uint64_t timeout) {
+    deadlines_.push(Deadline(uv_now(uv_default_loop()) + timeout, transId));
+    running_.insert(transId);
+    Arm();
+}
+
+bool GNDeadlines::Finish(getdns_transaction_t transId) {
+    running_.erase(transId);
+    return expired_.erase(transId) > 0;
+}
+
+void GNDeadlines::Close() {
+    uv_timer_stop(&timer_);
+    uv_close((uv_handle_t*) &timer_, GNDeadlines::OnClosed);
+}
+
+void GNDeadlines::OnClosed(uv_handle_t* handle) {
+    delete static_cast<GNDeadlines*>(handle->data);
+}
+
+void GNDeadlines::Arm() {
+    // drop finished lookups, so the timer doesn't fire for nothing
+    while (!deadlines_.empty() && running_.count(deadlines_.top().second) == 0) {
+        deadlines_.pop();
+    }
+    if (deadlines_.empty()) {
+        uv_timer_stop(&timer_);
+        armed_ = 0;
+        return;
+    }
+    uint64_t next = deadlines_.top().first;
+    if (armed_ == next) {
+        return;
+    }
+    uint64_t now = uv_now(uv_default_loop());
+    uv_timer_start(&timer_, GNDeadlines::OnTimer, next > now ? next - now : 0, 0);
+    armed_ = next;
+}
+
+void GNDeadlines::OnTimer(uv_timer_t* handle) {
+    GNDeadlines* deadlines = static_cast<GNDeadlines*>(handle->data);
+    uint64_t now = uv_now(uv_default_loop());
+    deadlines->armed_ = 0;
+    while (!deadlines->deadlines_.empty() && deadlines->deadlines_.top().first <= now) {
+        getdns_transaction_t transId = deadlines->deadlines_.top().second;
+        deadlines->deadlines_.pop();
+        if (deadlines->running_.erase(transId) == 0) {
+            continue;
+        }
+        deadlines->expired_.insert(transId);
+        // NOTE: may call back right away, which calls Finish
+        if (deadlines->ctx_->CancelCallback(transId) != GETDNS_RETURN_GOOD) {
+            // it finished meanwhile
+            deadlines->expired_.erase(transId);
+        }
+    }
+    deadlines->Arm();
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_DEADLINES_H_
+#define _GN_DEADLINES_H_
+
+#include <uv.h>
+#include <getdns/getdns.h>
+
+#include <functional>
+#include <queue>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class GNContext;
+
+// Per lookup timeouts of a context, shorter than the context timeout.
+// One timer for all lookups, armed for the earliest deadline; a lookup
+// past its deadline is cancelled, and its callback then reports a
+// timeout rather than a cancellation.
+class GNDeadlines {
+public:
+    explicit GNDeadlines(GNContext* ctx);
+
+    // Cancel the lookup when it's still running after timeout ms
+    void Add(getdns_transaction_t transId, uint64_t timeout);
+
+    // Forget a lookup that called back, true when it was cancelled for
+    // its deadline
+    bool Finish(getdns_transaction_t transId);
+
+    // Stop the timer and free once it is closed
+    void Close();
+
+private:
+    typedef std::pair<uint64_t, getdns_transaction_t> Deadline;
+
+    ~GNDeadlines() { }
+
+    void Arm();
+
+    static void OnTimer(uv_timer_t* handle);
+    static void OnClosed(uv_handle_t* handle);
+
+    GNContext* ctx_;
+    uv_timer_t timer_;
+    // earliest deadline first; finished lookups are skipped when popped
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline> > deadlines_;
+    std::unordered_set<getdns_transaction_t> running_;
+    std::unordered_set<getdns_transaction_t> expired_;
+    // deadline the timer is armed for, 0 when stopped
+    uint64_t armed_;
+};
+
+#endif
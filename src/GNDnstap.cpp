@@ -0,0 +1,578 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNDnstap.h"
+#include "GNUtil.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace v8;
+
+static const char CONTENT_TYPE[] = "protobuf:dnstap.Dnstap";
+
+// dnstap Message types and socket families and protocols
+enum {
+    STUB_QUERY = 9,
+    STUB_RESPONSE = 10,
+    FAMILY_INET = 1,
+    FAMILY_INET6 = 2,
+    PROTOCOL_UDP = 1,
+    PROTOCOL_TCP = 2,
+    PROTOCOL_DOT = 3
+};
+
+static const size_t DEFAULT_QUEUE = 4096;
+// writes are batched up to this size
+static const size_t BATCH_SIZE = 64 * 1024;
+// a socket reader that stops reading fails the output after this many
+// seconds, and the writer gets as long to write out the queue when the
+// last context is destroyed, as that blocks the loop thread
+static const time_t SOCKET_TIMEOUT = 5;
+static const uint64_t CLOSE_TIMEOUT = 1000000000;
+
+// Protocol buffer encoding of the few field types dnstap uses
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((char) (value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char) value);
+}
+
+static void putUint(std::string& out, uint32_t field, uint64_t value) {
+    putVarint(out, field << 3);
+    putVarint(out, value);
+}
+
+static void putFixed32(std::string& out, uint32_t field, uint32_t value) {
+    putVarint(out, (field << 3) | 5);
+    for (int i = 0; i < 4; ++i) {
+        out.push_back((char) (value >> (8 * i)));
+    }
+}
+
+static void putBytes(std::string& out, uint32_t field, const void* data, size_t length) {
+    putVarint(out, (field << 3) | 2);
+    putVarint(out, length);
+    out.append(static_cast<const char*>(data), length);
+}
+
+static void putBigEndian32(std::string& out, uint32_t value) {
+    for (int i = 3; i >= 0; --i) {
+        out.push_back((char) (value >> (8 * i)));
+    }
+}
+
+// The query a reply answers: its id, opcode, RD and CD flags, and
+// question. Empty when the reply has no question
+static std::string queryOfReply(const uint8_t* wire, size_t length) {
+    if (length < 12 || (wire[4] == 0 && wire[5] == 0)) {
+        return std::string();
+    }
+    size_t end = 12;
+    while (end < length && wire[end] != 0) {
+        if ((wire[end] & 0xC0) != 0) {
+            // NOTE: the first name of a message can't be compressed
+            return std::string();
+        }
+        end += wire[end] + 1;
+    }
+    // root label, type and class
+    end += 5;
+    if (end > length) {
+        return std::string();
+    }
+    const uint8_t header[12] = {
+        wire[0], wire[1], (uint8_t) (wire[2] & 0x79), (uint8_t) (wire[3] & 0x10),
+        0, 1, 0, 0, 0, 0, 0, 0
+    };
+    std::string query(reinterpret_cast<const char*>(header), sizeof(header));
+    query.append(reinterpret_cast<const char*>(wire) + 12, end - 12);
+    return query;
+}
+
+// A recursion desired query for name, empty for names that don't fit
+static std::string queryOfName(const std::string& name, uint16_t type) {
+    static const uint8_t header[12] = { 0, 0, 0x01, 0, 0, 1, 0, 0, 0, 0, 0, 0 };
+    std::string query(reinterpret_cast<const char*>(header), sizeof(header));
+    size_t start = 0;
+    while (start < name.size()) {
+        size_t dot = name.find('.', start);
+        if (dot == std::string::npos) {
+            dot = name.size();
+        }
+        size_t label = dot - start;
+        if (label == 0 || label > 63) {
+            return std::string();
+        }
+        query.push_back((char) label);
+        query.append(name, start, label);
+        start = dot + 1;
+    }
+    if (query.size() - sizeof(header) > 254) {
+        return std::string();
+    }
+    query.push_back(0);
+    query.push_back((char) (type >> 8));
+    query.push_back((char) type);
+    // class IN
+    query.push_back(0);
+    query.push_back(1);
+    return query;
+}
+
+static bool readCount(Local<Object> opts, const char* name, uint32_t* value) {
+    Local<Value> count = Nan::Get(opts, Nan::New<String>(name).ToLocalChecked()).ToLocalChecked();
+    if (count->IsUndefined()) {
+        return true;
+    }
+    if (!count->IsNumber() || Nan::To<double>(count).FromJust() < 1 ||
+        Nan::To<double>(count).FromJust() > 0x100000) {
+        return false;
+    }
+    *value = Nan::To<uint32_t>(count).FromJust();
+    return true;
+}
+
+std::map<std::string, GNDnstap*> GNDnstap::writers_;
+
+GNDnstap::GNDnstap() : refs_(1), fd_(-1), socket_(false), queue_(DEFAULT_QUEUE), sample_(1), sampleCount_(0), mask_(0), head_(0), tail_(0),
+    sleeping_(0), stopping_(0), closeDeadline_(0), logged_(0), skipped_(0), dropped_(0), lost_(0), written_(0),
+    bytes_(0), errors_(0) {
+    uv_mutex_init(&mutex_);
+    uv_cond_init(&cond_);
+}
+
+GNDnstap::~GNDnstap() {
+    for (size_t i = head_; i != tail_; ++i) {
+        delete slots_[i & mask_];
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    uv_cond_destroy(&cond_);
+    uv_mutex_destroy(&mutex_);
+}
+
+GNDnstap* GNDnstap::Create(Local<Value> options) {
+    GNDnstap* dnstap = new GNDnstap();
+    Local<Value> path = Nan::Undefined();
+    Local<Value> socketPath = Nan::Undefined();
+    Local<Value> identity = Nan::Undefined();
+    bool valid = GNUtil::isDictionaryObject(options);
+    if (valid) {
+        Local<Object> opts = Nan::To<Object>(options).ToLocalChecked();
+        path = Nan::Get(opts, Nan::New<String>("path").ToLocalChecked()).ToLocalChecked();
+        socketPath = Nan::Get(opts, Nan::New<String>("socket").ToLocalChecked()).ToLocalChecked();
+        identity = Nan::Get(opts, Nan::New<String>("identity").ToLocalChecked()).ToLocalChecked();
+        // exactly one output
+        valid = (path->IsString() && socketPath->IsUndefined()) || (path->IsUndefined() && socketPath->IsString());
+        valid = valid && (identity->IsUndefined() || identity->IsString());
+        valid = valid && readCount(opts, "sample", &dnstap->sample_) && readCount(opts, "queue", &dnstap->queue_);
+    }
+    if (!valid) {
+        delete dnstap;
+        Nan::ThrowError(GNUtil::makeTypeErrorWithCode("dnstap", GETDNS_RETURN_INVALID_PARAMETER));
+        return NULL;
+    }
+    dnstap->socket_ = socketPath->IsString();
+    dnstap->path_ = *Nan::Utf8String(dnstap->socket_ ? socketPath : path);
+    dnstap->output_ = (dnstap->socket_ ? "socket:" : "path:") + dnstap->path_;
+    if (identity->IsString()) {
+        dnstap->identity_ = *Nan::Utf8String(identity);
+    }
+
+    // NOTE: a second writer would truncate the file, or start a second
+    // stream on the socket; the options of the first apply
+    std::map<std::string, GNDnstap*>::iterator shared = writers_.find(dnstap->output_);
+    if (shared != writers_.end()) {
+        delete dnstap;
+        shared->second->refs_++;
+        return shared->second;
+    }
+
+    size_t slots = 2;
+    while (slots < dnstap->queue_) {
+        slots <<= 1;
+    }
+    dnstap->slots_.resize(slots, NULL);
+    dnstap->mask_ = slots - 1;
+
+    int err = 0;
+    if (!dnstap->socket_) {
+        dnstap->fd_ = open(dnstap->path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        err = dnstap->fd_ < 0 ? errno : 0;
+    } else {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (dnstap->path_.size() >= sizeof(addr.sun_path)) {
+            err = ENAMETOOLONG;
+        } else {
+            strcpy(addr.sun_path, dnstap->path_.c_str());
+            dnstap->fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (dnstap->fd_ < 0 || connect(dnstap->fd_, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+                err = errno;
+            }
+        }
+    }
+    if (err == 0 && uv_thread_create(&dnstap->thread_, GNDnstap::Run, dnstap) != 0) {
+        err = EAGAIN;
+    }
+    if (err != 0) {
+        delete dnstap;
+        std::string msg = std::string("Unable to open dnstap output: ") + strerror(err);
+        Nan::ThrowError(Nan::New<String>(msg).ToLocalChecked());
+        return NULL;
+    }
+    writers_[dnstap->output_] = dnstap;
+    return dnstap;
+}
+
+Local<Object> GNDnstap::Options() {
+    Local<Object> options = Nan::New<Object>();
+    Nan::Set(options, Nan::New<String>(socket_ ? "socket" : "path").ToLocalChecked(),
+             Nan::New<String>(path_).ToLocalChecked());
+    Nan::Set(options, Nan::New<String>("sample").ToLocalChecked(), Nan::New<Uint32>(sample_));
+    Nan::Set(options, Nan::New<String>("queue").ToLocalChecked(), Nan::New<Uint32>(queue_));
+    if (!identity_.empty()) {
+        Nan::Set(options, Nan::New<String>("identity").ToLocalChecked(), Nan::New<String>(identity_).ToLocalChecked());
+    }
+    return options;
+}
+
+void GNDnstap::Close() {
+    if (--refs_ > 0) {
+        return;
+    }
+    writers_.erase(output_);
+    uv_mutex_lock(&mutex_);
+    __atomic_store_n(&stopping_, 1, __ATOMIC_SEQ_CST);
+    uv_cond_signal(&cond_);
+    uv_mutex_unlock(&mutex_);
+    uv_thread_join(&thread_);
+    delete this;
+}
+
+void GNDnstap::Log(getdns_dict* response, GNEngine::QueryKind kind, const std::string& name, uint16_t type, uint64_t age) {
+    if (sampleCount_++ % sample_ != 0) {
+        skipped_++;
+        return;
+    }
+    struct timeval responseTime;
+    gettimeofday(&responseTime, NULL);
+    struct timeval queryTime = responseTime;
+    uint64_t ageUsec = age * 1000;
+    uint64_t nowUsec = (uint64_t) responseTime.tv_sec * 1000000 + responseTime.tv_usec;
+    if (ageUsec < nowUsec) {
+        queryTime.tv_sec = (nowUsec - ageUsec) / 1000000;
+        queryTime.tv_usec = (nowUsec - ageUsec) % 1000000;
+    }
+
+    // the upstream, when the lookup asked for call reporting
+    getdns_bindata* upstream = NULL;
+    uint32_t port = 53;
+    uint32_t protocol = 0;
+    getdns_list* reports = NULL;
+    getdns_dict* report = NULL;
+    if (getdns_dict_get_list(response, "call_reporting", &reports) == GETDNS_RETURN_GOOD &&
+        getdns_list_get_dict(reports, 0, &report) == GETDNS_RETURN_GOOD) {
+        getdns_dict* queryTo = NULL;
+        if (getdns_dict_get_dict(report, "query_to", &queryTo) == GETDNS_RETURN_GOOD) {
+            getdns_dict_get_bindata(queryTo, "address_data", &upstream);
+            getdns_dict_get_int(queryTo, "port", &port);
+        }
+        uint32_t transport = 0;
+        if (getdns_dict_get_int(report, "transport", &transport) == GETDNS_RETURN_GOOD) {
+            protocol = transport == GETDNS_TRANSPORT_UDP ? PROTOCOL_UDP
+                     : transport == GETDNS_TRANSPORT_TCP ? PROTOCOL_TCP
+                     : transport == GETDNS_TRANSPORT_TLS ? PROTOCOL_DOT : 0;
+        }
+    }
+
+    getdns_list* replies = NULL;
+    size_t numReplies = 0;
+    if (getdns_dict_get_list(response, "replies_full", &replies) == GETDNS_RETURN_GOOD) {
+        getdns_list_get_length(replies, &numReplies);
+    }
+    for (size_t i = 0; i < numReplies; ++i) {
+        getdns_bindata* reply = NULL;
+        if (getdns_list_get_bindata(replies, i, &reply) != GETDNS_RETURN_GOOD) {
+            continue;
+        }
+        std::string responseWire(reinterpret_cast<const char*>(reply->data), reply->size);
+        std::string query = queryOfReply(reply->data, reply->size);
+        Emit(STUB_QUERY, query, std::string(), queryTime, NULL, upstream, port, protocol);
+        Emit(STUB_RESPONSE, std::string(), responseWire, queryTime, &responseTime, upstream, port, protocol);
+    }
+    if (numReplies == 0) {
+        // unanswered, as far as names and types are known
+        if (kind == GNEngine::GeneralQuery) {
+            Emit(STUB_QUERY, queryOfName(name, type), std::string(), queryTime, NULL, upstream, port, protocol);
+        } else if (kind == GNEngine::AddressQuery) {
+            Emit(STUB_QUERY, queryOfName(name, GETDNS_RRTYPE_A), std::string(), queryTime, NULL, upstream, port, protocol);
+            Emit(STUB_QUERY, queryOfName(name, GETDNS_RRTYPE_AAAA), std::string(), queryTime, NULL, upstream, port, protocol);
+        }
+    }
+}
+
+void GNDnstap::Emit(uint32_t messageType, const std::string& query, const std::string& response,
+                    const struct timeval& queryTime, const struct timeval* responseTime,
+                    getdns_bindata* upstream, uint32_t port, uint32_t protocol) {
+    std::string message;
+    putUint(message, 1, messageType);
+    if (upstream && (upstream->size == 4 || upstream->size == 16)) {
+        putUint(message, 2, upstream->size == 4 ? FAMILY_INET : FAMILY_INET6);
+    }
+    if (protocol) {
+        putUint(message, 3, protocol);
+    }
+    if (upstream && (upstream->size == 4 || upstream->size == 16)) {
+        putBytes(message, 5, upstream->data, upstream->size);
+        putUint(message, 7, port);
+    }
+    putUint(message, 8, queryTime.tv_sec);
+    putFixed32(message, 9, queryTime.tv_usec * 1000);
+    if (!query.empty()) {
+        putBytes(message, 10, query.data(), query.size());
+    }
+    if (responseTime) {
+        putUint(message, 12, responseTime->tv_sec);
+        putFixed32(message, 13, responseTime->tv_usec * 1000);
+        putBytes(message, 14, response.data(), response.size());
+    }
+
+    std::string* frame = new std::string();
+    frame->reserve(message.size() + identity_.size() + 16);
+    // length, filled in below
+    putBigEndian32(*frame, 0);
+    if (!identity_.empty()) {
+        putBytes(*frame, 1, identity_.data(), identity_.size());
+    }
+    putBytes(*frame, 14, message.data(), message.size());
+    // type MESSAGE
+    putUint(*frame, 15, 1);
+    uint32_t length = frame->size() - 4;
+    for (int i = 0; i < 4; ++i) {
+        (*frame)[i] = (char) (length >> (8 * (3 - i)));
+    }
+    Push(frame);
+}
+
+void GNDnstap::Push(std::string* frame) {
+    size_t tail = tail_;
+    if (tail - __atomic_load_n(&head_, __ATOMIC_ACQUIRE) > mask_) {
+        dropped_++;
+        delete frame;
+        return;
+    }
+    slots_[tail & mask_] = frame;
+    // NOTE: sequentially consistent with the writer's sleeping_ store,
+    // so either the writer sees the frame or the push sees it sleeping
+    __atomic_store_n(&tail_, tail + 1, __ATOMIC_SEQ_CST);
+    logged_++;
+    if (__atomic_load_n(&sleeping_, __ATOMIC_SEQ_CST)) {
+        uv_mutex_lock(&mutex_);
+        uv_cond_signal(&cond_);
+        uv_mutex_unlock(&mutex_);
+    }
+}
+
+std::string* GNDnstap::Pop() {
+    size_t head = head_;
+    if (head == __atomic_load_n(&tail_, __ATOMIC_SEQ_CST)) {
+        return NULL;
+    }
+    std::string* frame = slots_[head & mask_];
+    __atomic_store_n(&head_, head + 1, __ATOMIC_RELEASE);
+    return frame;
+}
+
+bool GNDnstap::WriteAll(const char* data, size_t length) {
+    while (length > 0) {
+        if (closeDeadline_ && uv_hrtime() > closeDeadline_) {
+            // a slow reader doesn't get to hold up the close either
+            return false;
+        }
+        ssize_t n = socket_ ? send(fd_, data, length, MSG_NOSIGNAL) : write(fd_, data, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+bool GNDnstap::WriteControl(uint32_t type, bool contentType) {
+    std::string control;
+    putBigEndian32(control, type);
+    if (contentType) {
+        putBigEndian32(control, 1);
+        putBigEndian32(control, sizeof(CONTENT_TYPE) - 1);
+        control.append(CONTENT_TYPE, sizeof(CONTENT_TYPE) - 1);
+    }
+    std::string frame;
+    // escape, then the control frame length
+    putBigEndian32(frame, 0);
+    putBigEndian32(frame, control.size());
+    frame += control;
+    return WriteAll(frame.data(), frame.size());
+}
+
+bool GNDnstap::ReadControl(uint32_t type) {
+    uint8_t header[12];
+    size_t got = 0;
+    while (got < sizeof(header)) {
+        ssize_t n = recv(fd_, header + got, sizeof(header) - got, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    uint32_t length = (header[4] << 24) | (header[5] << 16) | (header[6] << 8) | header[7];
+    uint32_t controlType = (header[8] << 24) | (header[9] << 16) | (header[10] << 8) | header[11];
+    // skip the fields, the content type is the only one
+    std::vector<uint8_t> fields(length > 4 ? length - 4 : 0);
+    got = 0;
+    while (got < fields.size()) {
+        ssize_t n = recv(fd_, fields.data() + got, fields.size() - got, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return controlType == type;
+}
+
+void GNDnstap::Run(void* arg) {
+    GNDnstap* dnstap = static_cast<GNDnstap*>(arg);
+    bool ok = true;
+    if (dnstap->socket_) {
+        // bidirectional Frame Streams handshake, don't hang on a silent reader
+        struct timeval timeout = { SOCKET_TIMEOUT, 0 };
+        setsockopt(dnstap->fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(dnstap->fd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        ok = dnstap->WriteControl(CONTROL_READY, true) && dnstap->ReadControl(CONTROL_ACCEPT);
+    }
+    ok = ok && dnstap->WriteControl(CONTROL_START, true);
+    if (!ok) {
+        __atomic_fetch_add(&dnstap->errors_, 1, __ATOMIC_RELAXED);
+    }
+
+    std::string batch;
+    batch.reserve(BATCH_SIZE);
+    uint64_t frames = 0;
+    for (;;) {
+        if (!dnstap->closeDeadline_ && __atomic_load_n(&dnstap->stopping_, __ATOMIC_SEQ_CST)) {
+            dnstap->closeDeadline_ = uv_hrtime() + CLOSE_TIMEOUT;
+            if (dnstap->socket_) {
+                struct timeval timeout = { CLOSE_TIMEOUT / 1000000000, 0 };
+                setsockopt(dnstap->fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(dnstap->fd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            }
+        }
+        if (ok && dnstap->closeDeadline_ && uv_hrtime() > dnstap->closeDeadline_) {
+            // NOTE: what is left is lost, along with the STOP frame
+            ok = false;
+            __atomic_fetch_add(&dnstap->errors_, 1, __ATOMIC_RELAXED);
+        }
+        std::string* frame = NULL;
+        while ((frame = dnstap->Pop()) != NULL) {
+            batch += *frame;
+            frames++;
+            delete frame;
+            if (batch.size() >= BATCH_SIZE) {
+                break;
+            }
+        }
+        if (!batch.empty()) {
+            if (ok && dnstap->WriteAll(batch.data(), batch.size())) {
+                __atomic_fetch_add(&dnstap->written_, frames, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&dnstap->bytes_, batch.size(), __ATOMIC_RELAXED);
+            } else {
+                if (ok) {
+                    __atomic_fetch_add(&dnstap->errors_, 1, __ATOMIC_RELAXED);
+                }
+                // NOTE: a failed output stays failed, its frames are lost
+                ok = false;
+                __atomic_fetch_add(&dnstap->lost_, frames, __ATOMIC_RELAXED);
+            }
+            batch.clear();
+            frames = 0;
+            continue;
+        }
+        uv_mutex_lock(&dnstap->mutex_);
+        __atomic_store_n(&dnstap->sleeping_, 1, __ATOMIC_SEQ_CST);
+        bool empty = dnstap->head_ == __atomic_load_n(&dnstap->tail_, __ATOMIC_SEQ_CST);
+        bool stopping = __atomic_load_n(&dnstap->stopping_, __ATOMIC_SEQ_CST);
+        if (empty && !stopping) {
+            uv_cond_wait(&dnstap->cond_, &dnstap->mutex_);
+        }
+        __atomic_store_n(&dnstap->sleeping_, 0, __ATOMIC_SEQ_CST);
+        uv_mutex_unlock(&dnstap->mutex_);
+        if (empty && stopping) {
+            break;
+        }
+    }
+
+    if (ok && dnstap->WriteControl(CONTROL_STOP, false) && dnstap->socket_) {
+        dnstap->ReadControl(CONTROL_FINISH);
+    }
+}
+
+Local<Object> GNDnstap::Stats() {
+    Local<Object> stats = Nan::New<Object>();
+    size_t queued = tail_ - __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+    Nan::Set(stats, Nan::New<String>("queued").ToLocalChecked(), Nan::New<Number>((double) queued));
+    Nan::Set(stats, Nan::New<String>("logged").ToLocalChecked(), Nan::New<Number>((double) logged_));
+    Nan::Set(stats, Nan::New<String>("skipped").ToLocalChecked(), Nan::New<Number>((double) skipped_));
+    Nan::Set(stats, Nan::New<String>("dropped").ToLocalChecked(),
+             Nan::New<Number>((double) (dropped_ + __atomic_load_n(&lost_, __ATOMIC_RELAXED))));
+    Nan::Set(stats, Nan::New<String>("written").ToLocalChecked(),
+             Nan::New<Number>((double) __atomic_load_n(&written_, __ATOMIC_RELAXED)));
+    Nan::Set(stats, Nan::New<String>("bytes").ToLocalChecked(),
+             Nan::New<Number>((double) __atomic_load_n(&bytes_, __ATOMIC_RELAXED)));
+    Nan::Set(stats, Nan::New<String>("errors").ToLocalChecked(),
+             Nan::New<Number>((double) __atomic_load_n(&errors_, __ATOMIC_RELAXED)));
+    return stats;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_DNSTAP_H_
+#define _GN_DNSTAP_H_
+
+#include <nan.h>
+#include <uv.h>
+#include <sys/time.h>
+#include <getdns/getdns.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "GNEngine.h"
+
+// Logs the queries and responses of a context as dnstap messages in a
+// Frame Streams file or unix socket, without calling into javascript.
+// Frames are encoded when a lookup calls back, from the wire format
+// replies of the response dict, and pushed into a single producer,
+// single consumer ring. A writer thread drains the ring in batches;
+// frames are dropped when the ring is full or the output failed, and
+// counted.
+//
+// Each reply is logged as a STUB_QUERY and a STUB_RESPONSE message. The
+// query is rebuilt from the header and question of the reply, and the
+// upstream is taken from the call reporting of the response when the
+// lookup asked for it. Lookups without replies log a STUB_QUERY built
+// from the queried name.
+//
+// Contexts logging to the same output, those of a pool for instance,
+// share its writer, so the output holds a single stream.
+class GNDnstap {
+public:
+    // Read the dnstap creation option and open the output, or share the
+    // writer already open for it. NULL, with an error thrown, for invalid
+    // options or an output that can't be opened
+    static GNDnstap* Create(v8::Local<v8::Value> options);
+
+    // The options of the writer, in the format of the creation option
+    v8::Local<v8::Object> Options();
+
+    // Log the replies of a lookup that called back after age ms, or
+    // skip it for the sampling
+    void Log(getdns_dict* response, GNEngine::QueryKind kind, const std::string& name, uint16_t type, uint64_t age);
+
+    // { queued, logged, skipped, dropped, written, bytes, errors }
+    v8::Local<v8::Object> Stats();
+
+    // Release the writer of a context. The last one writes out the
+    // queued frames, stops the writer and frees
+    void Close();
+
+private:
+    // Frame Streams control frames
+    enum {
+        CONTROL_ACCEPT = 1,
+        CONTROL_START = 2,
+        CONTROL_STOP = 3,
+        CONTROL_READY = 4,
+        CONTROL_FINISH = 5
+    };
+
+    GNDnstap();
+    ~GNDnstap();
+
+    void Emit(uint32_t messageType, const std::string& query, const std::string& response,
+              const struct timeval& queryTime, const struct timeval* responseTime,
+              getdns_bindata* upstream, uint32_t port, uint32_t protocol);
+    void Push(std::string* frame);
+    std::string* Pop();
+
+    bool WriteAll(const char* data, size_t length);
+    bool WriteControl(uint32_t type, bool contentType);
+    bool ReadControl(uint32_t type);
+
+    static void Run(void* arg);
+
+    // open writers by output, "path:" or "socket:" and the path
+    static std::map<std::string, GNDnstap*> writers_;
+
+    std::string output_;
+    size_t refs_;
+    int fd_;
+    bool socket_;
+    std::string path_;
+    std::string identity_;
+    uint32_t queue_;
+    uint32_t sample_;
+    uint64_t sampleCount_;
+
+    // power of two slots; head_ is advanced by the writer, tail_ by the
+    // loop thread
+    std::vector<std::string*> slots_;
+    size_t mask_;
+    size_t head_;
+    size_t tail_;
+
+    uv_thread_t thread_;
+    uv_mutex_t mutex_;
+    uv_cond_t cond_;
+    // set by the writer before it waits, checked by the loop after a push
+    int sleeping_;
+    int stopping_;
+    // writer thread, uv_hrtime by which the output must be closed once
+    // stopping, 0 before
+    uint64_t closeDeadline_;
+
+    // loop thread
+    uint64_t logged_;
+    uint64_t skipped_;
+    uint64_t dropped_;
+    // writer thread, read with atomics
+    uint64_t lost_;
+    uint64_t written_;
+    uint64_t bytes_;
+    uint64_t errors_;
+};
+
+#endif
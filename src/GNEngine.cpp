@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNEngine.h"
+#include "GNUtil.h"
+
+GNEngine::GNEngine(getdns_context* context) :
+    context_(context), pauseRequests_(0), paused_(false), stopping_(false),
+    issuing_(0), issuingDone_(false), nextId_(0) {
+    uv_mutex_init(&mutex_);
+    uv_cond_init(&cond_);
+}
+
+GNEngine::~GNEngine() {
+    uv_cond_destroy(&cond_);
+    uv_mutex_destroy(&mutex_);
+}
+
+GNEngine* GNEngine::Start(getdns_context* context) {
+    GNEngine* engine = new GNEngine(context);
+    if (uv_loop_init(&engine->loop_) != 0) {
+        delete engine;
+        return NULL;
+    }
+    uv_async_init(&engine->loop_, &engine->wakeup_, GNEngine::OnWakeup);
+    engine->wakeup_.data = engine;
+    if (!GNUtil::attachContextToLoop(context, &engine->loop_) ||
+        uv_thread_create(&engine->thread_, GNEngine::Run, engine) != 0) {
+        // the loop never ran, so nothing is scheduled on it yet
+        GNUtil::attachContextToNode(context);
+        uv_close((uv_handle_t*) &engine->wakeup_, NULL);
+        uv_run(&engine->loop_, UV_RUN_DEFAULT);
+        uv_loop_close(&engine->loop_);
+        delete engine;
+        return NULL;
+    }
+    // only keeps node alive while lookups are pending
+    uv_async_init(uv_default_loop(), &engine->deliver_, GNEngine::OnDeliver);
+    engine->deliver_.data = engine;
+    uv_unref((uv_handle_t*) &engine->deliver_);
+    return engine;
+}
+
+void GNEngine::Destroy() {
+    {
+        Pause pause(this);
+        getdns_context_destroy(context_);
+        context_ = NULL;
+    }
+    uv_mutex_lock(&mutex_);
+    stopping_ = true;
+    uv_mutex_unlock(&mutex_);
+    uv_async_send(&wakeup_);
+    uv_thread_join(&thread_);
+
+    // deliver what the destroy and the last wakeup cancelled
+    GNEngine::OnDeliver(&deliver_);
+    uv_close((uv_handle_t*) &deliver_, GNEngine::OnDeliverClosed);
+}
+
+getdns_return_t GNEngine::Submit(QueryKind kind,
+                                 const char* name,
+                                 uint16_t type,
+                                 getdns_dict* address,
+                                 getdns_dict* extensions,
+                                 void* userArg,
+                                 getdns_transaction_t* transId,
+                                 getdns_callback_t callback) {
+    Command* command = new Command();
+    command->engine = this;
+    command->kind = kind;
+    command->cancel = false;
+    command->name = name ? name : "";
+    command->type = type;
+    // dicts can't be shared between threads, setting one copies it
+    command->args = getdns_dict_create();
+    if (address) {
+        getdns_dict_set_dict(command->args, "address", address);
+    }
+    if (extensions) {
+        getdns_dict_set_dict(command->args, "extensions", extensions);
+    }
+    command->userArg = userArg;
+    command->callback = callback;
+    command->id = ++nextId_;
+
+    uv_mutex_lock(&mutex_);
+    commands_.push_back(command);
+    uv_mutex_unlock(&mutex_);
+    uv_async_send(&wakeup_);
+
+    if (pending_.empty()) {
+        uv_ref((uv_handle_t*) &deliver_);
+    }
+    pending_.insert(command->id);
+    *transId = command->id;
+    return GETDNS_RETURN_GOOD;
+}
+
+bool GNEngine::Cancel(getdns_transaction_t transId) {
+    if (pending_.find(transId) == pending_.end()) {
+        return false;
+    }
+    Command* command = new Command();
+    command->engine = this;
+    command->cancel = true;
+    command->args = NULL;
+    command->id = transId;
+
+    uv_mutex_lock(&mutex_);
+    commands_.push_back(command);
+    uv_mutex_unlock(&mutex_);
+    uv_async_send(&wakeup_);
+    return true;
+}
+
+size_t GNEngine::CancelMany(const std::vector<getdns_transaction_t>& transIds) {
+    std::vector<Command*> commands;
+    for (size_t i = 0; i < transIds.size(); ++i) {
+        if (pending_.find(transIds[i]) == pending_.end()) {
+            continue;
+        }
+        Command* command = new Command();
+        command->engine = this;
+        command->cancel = true;
+        command->args = NULL;
+        command->id = transIds[i];
+        commands.push_back(command);
+    }
+    if (commands.empty()) {
+        return 0;
+    }
+
+    // NOTE: one lock and one wakeup for the whole batch
+    uv_mutex_lock(&mutex_);
+    commands_.insert(commands_.end(), commands.begin(), commands.end());
+    uv_mutex_unlock(&mutex_);
+    uv_async_send(&wakeup_);
+    return commands.size();
+}
+
+GNEngine::Pause::Pause(GNEngine* engine) : engine_(engine) {
+    if (!engine_) {
+        return;
+    }
+    uv_mutex_lock(&engine_->mutex_);
+    engine_->pauseRequests_++;
+    uv_async_send(&engine_->wakeup_);
+    while (!engine_->paused_) {
+        uv_cond_wait(&engine_->cond_, &engine_->mutex_);
+    }
+    uv_mutex_unlock(&engine_->mutex_);
+}
+
+GNEngine::Pause::~Pause() {
+    if (!engine_) {
+        return;
+    }
+    uv_mutex_lock(&engine_->mutex_);
+    if (--engine_->pauseRequests_ == 0) {
+        uv_cond_broadcast(&engine_->cond_);
+    }
+    uv_mutex_unlock(&engine_->mutex_);
+}
+
+void GNEngine::Run(void* arg) {
+    GNEngine* engine = static_cast<GNEngine*>(arg);
+    uv_run(&engine->loop_, UV_RUN_DEFAULT);
+    uv_loop_close(&engine->loop_);
+}
+
+void GNEngine::OnWakeup(uv_async_t* handle) {
+    GNEngine* engine = static_cast<GNEngine*>(handle->data);
+    std::vector<Command*> commands;
+
+    uv_mutex_lock(&engine->mutex_);
+    if (engine->pauseRequests_ > 0) {
+        // park until the main thread is done with the context
+        engine->paused_ = true;
+        uv_cond_broadcast(&engine->cond_);
+        while (engine->pauseRequests_ > 0) {
+            uv_cond_wait(&engine->cond_, &engine->mutex_);
+        }
+        engine->paused_ = false;
+    }
+    commands.swap(engine->commands_);
+    bool stopping = engine->stopping_;
+    uv_mutex_unlock(&engine->mutex_);
+
+    for (size_t i = 0; i < commands.size(); ++i) {
+        engine->Issue(commands[i]);
+    }
+    if (stopping) {
+        uv_close((uv_handle_t*) &engine->wakeup_, NULL);
+        uv_stop(&engine->loop_);
+    }
+}
+
+void GNEngine::Issue(Command* command) {
+    if (command->cancel) {
+        std::unordered_map<getdns_transaction_t, getdns_transaction_t>::iterator it = issued_.find(command->id);
+        if (it != issued_.end() && context_) {
+            getdns_cancel_callback(context_, it->second);
+        }
+        delete command;
+        return;
+    }
+    if (!context_) {
+        Complete(command, GETDNS_CALLBACK_CANCEL, NULL);
+        return;
+    }
+
+    // the command belongs to the main thread once its callback ran
+    getdns_transaction_t id = command->id;
+    getdns_dict* args = command->args;
+    getdns_dict* address = NULL;
+    getdns_dict* extensions = NULL;
+    getdns_dict_get_dict(args, "address", &address);
+    getdns_dict_get_dict(args, "extensions", &extensions);
+    command->args = NULL;
+
+    getdns_transaction_t transId = 0;
+    getdns_return_t r = GETDNS_RETURN_GOOD;
+    issuing_ = id;
+    issuingDone_ = false;
+    switch (command->kind) {
+        case GeneralQuery:
+            r = getdns_general(context_, command->name.c_str(), command->type, extensions,
+                               command, &transId, GNEngine::EngineCallback);
+            break;
+        case AddressQuery:
+            r = getdns_address(context_, command->name.c_str(), extensions,
+                               command, &transId, GNEngine::EngineCallback);
+            break;
+        case ServiceQuery:
+            r = getdns_service(context_, command->name.c_str(), extensions,
+                               command, &transId, GNEngine::EngineCallback);
+            break;
+        case HostnameQuery:
+            r = getdns_hostname(context_, address, extensions,
+                                command, &transId, GNEngine::EngineCallback);
+            break;
+    }
+    getdns_dict_destroy(args);
+
+    if (r != GETDNS_RETURN_GOOD) {
+        Complete(command, GETDNS_CALLBACK_ERROR, NULL);
+    } else if (!issuingDone_) {
+        issued_[id] = transId;
+    }
+    issuing_ = 0;
+}
+
+void GNEngine::Complete(Command* command, getdns_callback_type_t cbType, getdns_dict* response) {
+    Completion completion;
+    completion.command = command;
+    completion.cbType = cbType;
+    completion.response = response;
+
+    uv_mutex_lock(&mutex_);
+    completions_.push_back(completion);
+    uv_mutex_unlock(&mutex_);
+    uv_async_send(&deliver_);
+}
+
+void GNEngine::EngineCallback(getdns_context* context,
+                              getdns_callback_type_t cbType,
+                              getdns_dict* response,
+                              void* userArg,
+                              getdns_transaction_t transId) {
+    Command* command = static_cast<Command*>(userArg);
+    GNEngine* engine = command->engine;
+    engine->issued_.erase(command->id);
+    if (command->id == engine->issuing_) {
+        // called back before getdns returned the transaction id
+        engine->issuingDone_ = true;
+    }
+    engine->Complete(command, cbType, response);
+}
+
+// Run the callbacks of a batch of completed lookups on the main thread
+void GNEngine::OnDeliver(uv_async_t* handle) {
+    GNEngine* engine = static_cast<GNEngine*>(handle->data);
+    std::vector<Completion> completions;
+
+    uv_mutex_lock(&engine->mutex_);
+    completions.swap(engine->completions_);
+    uv_mutex_unlock(&engine->mutex_);
+
+    for (size_t i = 0; i < completions.size(); ++i) {
+        Command* command = completions[i].command;
+        engine->pending_.erase(command->id);
+        command->callback(engine->context_, completions[i].cbType, completions[i].response,
+                          command->userArg, command->id);
+        delete command;
+    }
+    if (engine->pending_.empty() && !uv_is_closing((uv_handle_t*) &engine->deliver_)) {
+        uv_unref((uv_handle_t*) &engine->deliver_);
+    }
+}
+
+void GNEngine::OnDeliverClosed(uv_handle_t* handle) {
+    delete static_cast<GNEngine*>(handle->data);
+}
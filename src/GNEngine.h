@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_ENGINE_H_
+#define _GN_ENGINE_H_
+
+#include <getdns/getdns.h>
+#include <uv.h>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Runs a context on a dedicated thread with its own uv loop, so network
+// I/O, response parsing and DNSSEC validation stay off the main loop.
+//
+// Lookups are queued to the engine thread, which issues them. Completed
+// responses are handed back to the main thread in batches through a
+// uv_async, and the original getdns callbacks run there, so only the
+// final V8 object creation happens on the main thread. Transaction ids
+// are assigned by the engine, as getdns only assigns its own once the
+// engine thread issues the lookup.
+class GNEngine {
+public:
+    typedef enum QueryKind {
+        GeneralQuery = 0,
+        AddressQuery,
+        ServiceQuery,
+        HostnameQuery
+    } QueryKind;
+
+    // Attach the context to a new engine thread. NULL on failure
+    static GNEngine* Start(getdns_context* context);
+
+    // Destroy the context and stop the thread. Lookups still queued are
+    // cancelled and outstanding callbacks run before this returns, as
+    // with getdns_context_destroy. The engine frees itself afterwards
+    void Destroy();
+
+    // Queue a lookup, like getdns_general/address/service/hostname. The
+    // extensions and address are copied. Failures to issue it on the
+    // engine thread are reported as GETDNS_CALLBACK_ERROR.
+    getdns_return_t Submit(QueryKind kind,
+                           const char* name,
+                           uint16_t type,
+                           getdns_dict* address,
+                           getdns_dict* extensions,
+                           void* userArg,
+                           getdns_transaction_t* transId,
+                           getdns_callback_t callback);
+
+    // Queue the cancellation of a pending lookup. The callback follows
+    // asynchronously with GETDNS_CALLBACK_CANCEL
+    bool Cancel(getdns_transaction_t transId);
+
+    // Queue the cancellation of many pending lookups at once, returns
+    // how many of them were pending
+    size_t CancelMany(const std::vector<getdns_transaction_t>& transIds);
+
+    // Parks the engine thread for as long as it lives, so the main
+    // thread can use the context directly, e.g. to change its settings.
+    // Does nothing without an engine.
+    class Pause {
+    public:
+        explicit Pause(GNEngine* engine);
+        ~Pause();
+    private:
+        GNEngine* engine_;
+    };
+
+private:
+    typedef struct Command {
+        GNEngine* engine;
+        QueryKind kind;
+        bool cancel;
+        std::string name;
+        uint16_t type;
+        // holds copies of the "address" and "extensions" dicts
+        getdns_dict* args;
+        void* userArg;
+        getdns_callback_t callback;
+        getdns_transaction_t id;
+    } Command;
+
+    typedef struct Completion {
+        Command* command;
+        getdns_callback_type_t cbType;
+        getdns_dict* response;
+    } Completion;
+
+    GNEngine(getdns_context* context);
+    ~GNEngine();
+
+    // engine thread
+    static void Run(void* arg);
+    static void OnWakeup(uv_async_t* handle);
+    void Issue(Command* command);
+    void Complete(Command* command, getdns_callback_type_t cbType, getdns_dict* response);
+    static void EngineCallback(getdns_context* context,
+                               getdns_callback_type_t cbType,
+                               getdns_dict* response,
+                               void* userArg,
+                               getdns_transaction_t transId);
+
+    // main thread
+    static void OnDeliver(uv_async_t* handle);
+    static void OnDeliverClosed(uv_handle_t* handle);
+
+    getdns_context* context_;
+    uv_loop_t loop_;
+    uv_thread_t thread_;
+    uv_async_t wakeup_;
+    uv_async_t deliver_;
+
+    // guards everything shared between the threads below
+    uv_mutex_t mutex_;
+    uv_cond_t cond_;
+    std::vector<Command*> commands_;
+    std::vector<Completion> completions_;
+    int pauseRequests_;
+    bool paused_;
+    bool stopping_;
+
+    // engine thread only: engine ids to getdns ids of issued lookups
+    std::unordered_map<getdns_transaction_t, getdns_transaction_t> issued_;
+    getdns_transaction_t issuing_;
+    bool issuingDone_;
+
+    // main thread only: lookups not delivered yet
+    std::unordered_set<getdns_transaction_t> pending_;
+    getdns_transaction_t nextId_;
+};
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNMemoryPool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace v8;
+
+GNMemoryPool::GNMemoryPool(bool pooled) :
+    pooled_(pooled), slabCursor_(NULL), slabRemaining_(0),
+    bytes_(0), peak_(0), allocations_(0), frees_(0), reserved_(0), reported_(0) {
+    uv_mutex_init(&mutex_);
+    memset(freeLists_, 0, sizeof(freeLists_));
+}
+
+GNMemoryPool::~GNMemoryPool() {
+    for (size_t i = 0; i < slabs_.size(); ++i) {
+        free(slabs_[i]);
+    }
+    if (reported_ != 0) {
+        Nan::AdjustExternalMemory((int) -reported_);
+    }
+    uv_mutex_destroy(&mutex_);
+}
+
+getdns_return_t GNMemoryPool::CreateContext(getdns_context** context) {
+    return getdns_context_create_with_extended_memory_functions(context, 1, this,
+        GNMemoryPool::Malloc, GNMemoryPool::Realloc, GNMemoryPool::Free);
+}
+
+size_t GNMemoryPool::classFor(size_t size) {
+    size_t sizeClass = 0;
+    while (sizeClass < NUM_CLASSES && classSize(sizeClass) < size) {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+void GNMemoryPool::Count(size_t size) {
+    bytes_ += size;
+    if (bytes_ > peak_) {
+        peak_ = bytes_;
+    }
+    ++allocations_;
+}
+
+// Called with the mutex held
+GNMemoryPool::Header* GNMemoryPool::Allocate(size_t size) {
+    size_t sizeClass = pooled_ ? classFor(size) : (size_t) NUM_CLASSES;
+    Header* header = NULL;
+    if (sizeClass == NUM_CLASSES) {
+        header = static_cast<Header*>(malloc(sizeof(Header) + size));
+        if (!header) {
+            return NULL;
+        }
+        reserved_ += sizeof(Header) + size;
+    } else if (freeLists_[sizeClass]) {
+        header = freeLists_[sizeClass];
+        memcpy(&freeLists_[sizeClass], header + 1, sizeof(Header*));
+    } else {
+        size_t blockSize = sizeof(Header) + classSize(sizeClass);
+        if (slabRemaining_ < blockSize) {
+            // NOTE: the rest of the previous slab is left unused
+            char* slab = static_cast<char*>(malloc(SLAB_SIZE));
+            if (!slab) {
+                return NULL;
+            }
+            slabs_.push_back(slab);
+            reserved_ += SLAB_SIZE;
+            slabCursor_ = slab;
+            slabRemaining_ = SLAB_SIZE;
+        }
+        header = reinterpret_cast<Header*>(slabCursor_);
+        slabCursor_ += blockSize;
+        slabRemaining_ -= blockSize;
+    }
+    header->size = size;
+    header->sizeClass = sizeClass;
+    Count(size);
+    return header;
+}
+
+// Called with the mutex held
+void GNMemoryPool::Release(Header* header) {
+    bytes_ -= header->size;
+    ++frees_;
+    if (header->sizeClass == NUM_CLASSES) {
+        reserved_ -= sizeof(Header) + header->size;
+        free(header);
+    } else {
+        memcpy(header + 1, &freeLists_[header->sizeClass], sizeof(Header*));
+        freeLists_[header->sizeClass] = header;
+    }
+}
+
+void* GNMemoryPool::Malloc(void* userArg, size_t size) {
+    GNMemoryPool* pool = static_cast<GNMemoryPool*>(userArg);
+    uv_mutex_lock(&pool->mutex_);
+    Header* header = pool->Allocate(size);
+    uv_mutex_unlock(&pool->mutex_);
+    return header ? header + 1 : NULL;
+}
+
+void* GNMemoryPool::Realloc(void* userArg, void* ptr, size_t size) {
+    if (!ptr) {
+        return GNMemoryPool::Malloc(userArg, size);
+    }
+    GNMemoryPool* pool = static_cast<GNMemoryPool*>(userArg);
+    Header* header = static_cast<Header*>(ptr) - 1;
+    uv_mutex_lock(&pool->mutex_);
+    if (header->sizeClass < NUM_CLASSES && size <= classSize(header->sizeClass)) {
+        // still fits in its block
+        pool->bytes_ -= header->size;
+        --pool->allocations_;
+        pool->Count(size);
+        header->size = size;
+        uv_mutex_unlock(&pool->mutex_);
+        return ptr;
+    }
+    if (header->sizeClass == NUM_CLASSES && !pool->pooled_) {
+        size_t oldSize = header->size;
+        Header* moved = static_cast<Header*>(realloc(header, sizeof(Header) + size));
+        if (moved) {
+            pool->reserved_ = pool->reserved_ - oldSize + size;
+            pool->bytes_ -= oldSize;
+            --pool->allocations_;
+            pool->Count(size);
+            moved->size = size;
+        }
+        uv_mutex_unlock(&pool->mutex_);
+        return moved ? moved + 1 : NULL;
+    }
+    Header* moved = pool->Allocate(size);
+    if (moved) {
+        memcpy(moved + 1, ptr, header->size < size ? header->size : size);
+        pool->Release(header);
+        // a move is still one allocation
+        --pool->allocations_;
+        --pool->frees_;
+    }
+    uv_mutex_unlock(&pool->mutex_);
+    return moved ? moved + 1 : NULL;
+}
+
+void GNMemoryPool::Free(void* userArg, void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    GNMemoryPool* pool = static_cast<GNMemoryPool*>(userArg);
+    uv_mutex_lock(&pool->mutex_);
+    pool->Release(static_cast<Header*>(ptr) - 1);
+    uv_mutex_unlock(&pool->mutex_);
+}
+
+void GNMemoryPool::Sync(bool force) {
+    uv_mutex_lock(&mutex_);
+    int64_t delta = (int64_t) reserved_ - reported_;
+    uv_mutex_unlock(&mutex_);
+    if (delta != 0 && (force || delta >= REPORT_THRESHOLD || delta <= -REPORT_THRESHOLD)) {
+        Nan::AdjustExternalMemory((int) delta);
+        reported_ += delta;
+    }
+}
+
+Local<Object> GNMemoryPool::Stats() {
+    Sync(true);
+    uv_mutex_lock(&mutex_);
+    double bytes = (double) bytes_;
+    double peak = (double) peak_;
+    double allocations = (double) allocations_;
+    double live = (double) (allocations_ - frees_);
+    double reserved = (double) reserved_;
+    uv_mutex_unlock(&mutex_);
+
+    Local<Object> stats = Nan::New<Object>();
+    Nan::Set(stats, Nan::New<String>("allocator").ToLocalChecked(),
+             Nan::New<String>(Name()).ToLocalChecked());
+    Nan::Set(stats, Nan::New<String>("bytesAllocated").ToLocalChecked(), Nan::New<Number>(bytes));
+    Nan::Set(stats, Nan::New<String>("peakBytesAllocated").ToLocalChecked(), Nan::New<Number>(peak));
+    Nan::Set(stats, Nan::New<String>("allocationCount").ToLocalChecked(), Nan::New<Number>(allocations));
+    Nan::Set(stats, Nan::New<String>("liveAllocations").ToLocalChecked(), Nan::New<Number>(live));
+    Nan::Set(stats, Nan::New<String>("bytesReserved").ToLocalChecked(), Nan::New<Number>(reserved));
+    return stats;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_MEMORY_POOL_H_
+#define _GN_MEMORY_POOL_H_
+
+#include <node.h>
+#include <nan.h>
+#include <uv.h>
+#include <getdns/getdns.h>
+
+#include <vector>
+
+// Allocator for a context created with the allocator option, keeping
+// count of the memory getdns allocates for it. "pool" serves blocks up
+// to 2048 bytes from size classes carved out of 64KB slabs, which are
+// only returned to the system with the context; "malloc" only counts.
+// The memory reserved from the system is reported to V8 as external
+// memory. Allocations can come from a resolver thread, so the counters
+// are guarded by a mutex.
+class GNMemoryPool {
+public:
+    explicit GNMemoryPool(bool pooled);
+    ~GNMemoryPool();
+
+    // Create a context allocating through this pool
+    getdns_return_t CreateContext(getdns_context** context);
+
+    // "pool" or "malloc", the allocator option it was created for
+    const char* Name() const { return pooled_ ? "pool" : "malloc"; }
+
+    // Report the change in reserved memory to V8, from the main thread
+    void Sync(bool force = false);
+
+    // { allocator, bytesAllocated, peakBytesAllocated, allocationCount,
+    //   liveAllocations, bytesReserved }
+    v8::Local<v8::Object> Stats();
+
+private:
+    enum {
+        NUM_CLASSES = 8,
+        MIN_CLASS_SIZE = 16,
+        SLAB_SIZE = 64 * 1024,
+        REPORT_THRESHOLD = 64 * 1024
+    };
+
+    // Precedes every block, 16 bytes to keep the block aligned
+    typedef struct Header {
+        size_t size;
+        size_t sizeClass;
+    } Header;
+
+    static void* Malloc(void* userArg, size_t size);
+    static void* Realloc(void* userArg, void* ptr, size_t size);
+    static void Free(void* userArg, void* ptr);
+
+    static size_t classSize(size_t sizeClass) { return (size_t) MIN_CLASS_SIZE << sizeClass; }
+    static size_t classFor(size_t size);
+
+    Header* Allocate(size_t size);
+    void Release(Header* header);
+    void Count(size_t size);
+
+    uv_mutex_t mutex_;
+    bool pooled_;
+    Header* freeLists_[NUM_CLASSES];
+    std::vector<char*> slabs_;
+    char* slabCursor_;
+    size_t slabRemaining_;
+    size_t bytes_;
+    size_t peak_;
+    size_t allocations_;
+    size_t frees_;
+    size_t reserved_;
+    // only touched from the main thread
+    int64_t reported_;
+};
+
+#endif
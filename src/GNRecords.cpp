@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNRecords.h"
+#include "GNUtil.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace v8;
+
+// A name as node's dns module returns it, without the trailing dot
+static Local<Value> dnameValue(getdns_bindata* dname) {
+    char* fqdn = NULL;
+    if (!dname || getdns_convert_dns_name_to_fqdn(dname, &fqdn) != GETDNS_RETURN_GOOD) {
+        return Nan::New<String>("").ToLocalChecked();
+    }
+    size_t len = strlen(fqdn);
+    if (len > 1 && fqdn[len - 1] == '.') {
+        fqdn[--len] = '\0';
+    }
+    Local<Value> result = Nan::New<String>(fqdn, (int) len).ToLocalChecked();
+    free(fqdn);
+    return result;
+}
+
+static uint32_t dictInt(getdns_dict* dict, const char* key) {
+    uint32_t value = 0;
+    getdns_dict_get_int(dict, key, &value);
+    return value;
+}
+
+static Local<Value> rdataName(getdns_dict* rdata, const char* key) {
+    getdns_bindata* dname = NULL;
+    getdns_dict_get_bindata(rdata, key, &dname);
+    return dnameValue(dname);
+}
+
+static void setInt(Local<Object> obj, const char* key, uint32_t value) {
+    Nan::Set(obj, Nan::New<String>(key).ToLocalChecked(), Nan::New<Number>(value));
+}
+
+static void setValue(Local<Object> obj, const char* key, Local<Value> value) {
+    Nan::Set(obj, Nan::New<String>(key).ToLocalChecked(), value);
+}
+
+bool GNRecords::isSupported(uint16_t type) {
+    switch (type) {
+        case GETDNS_RRTYPE_A:
+        case GETDNS_RRTYPE_AAAA:
+        case GETDNS_RRTYPE_MX:
+        case GETDNS_RRTYPE_TXT:
+        case GETDNS_RRTYPE_SRV:
+        case GETDNS_RRTYPE_SOA:
+        case GETDNS_RRTYPE_PTR:
+        case GETDNS_RRTYPE_NS:
+        case GETDNS_RRTYPE_CNAME:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Local<Value> GNRecords::shape(getdns_dict* response, uint16_t type, bool withTtl) {
+    Nan::EscapableHandleScope scope;
+    Local<Array> records = Nan::New<Array>();
+    Local<Value> soa;
+    uint32_t idx = 0;
+    GNUtil::forEachRR(response, "answer", [&](getdns_dict* rr, uint32_t rrType) {
+        getdns_dict* rdata = NULL;
+        // skip the CNAME chain and anything else not asked for
+        if (rrType != type || getdns_dict_get_dict(rr, "rdata", &rdata) != GETDNS_RETURN_GOOD) {
+            return;
+        }
+        Local<Value> record;
+        switch (type) {
+            case GETDNS_RRTYPE_A:
+            case GETDNS_RRTYPE_AAAA: {
+                char* addrStr = GNUtil::rrAddressString(rr, rrType);
+                if (!addrStr) {
+                    return;
+                }
+                Local<Value> address = Nan::New<String>(addrStr).ToLocalChecked();
+                free(addrStr);
+                if (withTtl) {
+                    Local<Object> obj = Nan::New<Object>();
+                    setValue(obj, "address", address);
+                    setInt(obj, "ttl", dictInt(rr, "ttl"));
+                    record = obj;
+                } else {
+                    record = address;
+                }
+                break;
+            }
+            case GETDNS_RRTYPE_MX: {
+                Local<Object> obj = Nan::New<Object>();
+                setInt(obj, "priority", dictInt(rdata, "preference"));
+                setValue(obj, "exchange", rdataName(rdata, "exchange"));
+                record = obj;
+                break;
+            }
+            case GETDNS_RRTYPE_TXT: {
+                getdns_list* strings = NULL;
+                size_t numStrings = 0;
+                Local<Array> chunks = Nan::New<Array>();
+                if (getdns_dict_get_list(rdata, "txt_strings", &strings) == GETDNS_RETURN_GOOD) {
+                    getdns_list_get_length(strings, &numStrings);
+                }
+                for (size_t i = 0; i < numStrings; ++i) {
+                    getdns_bindata* chunk = NULL;
+                    if (getdns_list_get_bindata(strings, i, &chunk) == GETDNS_RETURN_GOOD) {
+                        Nan::Set(chunks, (uint32_t) i,
+                                 Nan::New<String>((const char*) chunk->data, (int) chunk->size).ToLocalChecked());
+                    }
+                }
+                record = chunks;
+                break;
+            }
+            case GETDNS_RRTYPE_SRV: {
+                Local<Object> obj = Nan::New<Object>();
+                setInt(obj, "priority", dictInt(rdata, "priority"));
+                setInt(obj, "weight", dictInt(rdata, "weight"));
+                setInt(obj, "port", dictInt(rdata, "port"));
+                setValue(obj, "name", rdataName(rdata, "target"));
+                record = obj;
+                break;
+            }
+            case GETDNS_RRTYPE_SOA: {
+                // like resolveSoa, only the first one counts
+                if (!soa.IsEmpty()) {
+                    return;
+                }
+                Local<Object> obj = Nan::New<Object>();
+                setValue(obj, "nsname", rdataName(rdata, "mname"));
+                setValue(obj, "hostmaster", rdataName(rdata, "rname"));
+                setInt(obj, "serial", dictInt(rdata, "serial"));
+                setInt(obj, "refresh", dictInt(rdata, "refresh"));
+                setInt(obj, "retry", dictInt(rdata, "retry"));
+                setInt(obj, "expire", dictInt(rdata, "expire"));
+                setInt(obj, "minttl", dictInt(rdata, "minimum"));
+                soa = obj;
+                return;
+            }
+            case GETDNS_RRTYPE_PTR:
+                record = rdataName(rdata, "ptrdname");
+                break;
+            case GETDNS_RRTYPE_NS:
+                record = rdataName(rdata, "nsdname");
+                break;
+            case GETDNS_RRTYPE_CNAME:
+                record = rdataName(rdata, "cname");
+                break;
+            default:
+                return;
+        }
+        Nan::Set(records, idx++, record);
+    });
+    if (type == GETDNS_RRTYPE_SOA) {
+        if (soa.IsEmpty()) {
+            return scope.Escape(Nan::Null());
+        }
+        return scope.Escape(soa);
+    }
+    if (idx == 0) {
+        return scope.Escape(Nan::Null());
+    }
+    return scope.Escape(records);
+}
+
+// Map the callback type, response status and rcode of the first reply
+// to the error codes c-ares based resolvers report
+static const char* dnsErrorCode(getdns_callback_type_t cbType, getdns_dict* response, uint32_t* status) {
+    *status = cbType;
+    if (cbType == GETDNS_CALLBACK_CANCEL) {
+        return "ECANCELLED";
+    } else if (cbType == GETDNS_CALLBACK_TIMEOUT) {
+        return "ETIMEOUT";
+    } else if (cbType != GETDNS_CALLBACK_COMPLETE || !response) {
+        return "ECONNREFUSED";
+    }
+    getdns_dict_get_int(response, "status", status);
+    if (*status == GETDNS_RESPSTATUS_ALL_TIMEOUT) {
+        return "ETIMEOUT";
+    } else if (*status == GETDNS_RESPSTATUS_NO_SECURE_ANSWERS ||
+               *status == GETDNS_RESPSTATUS_ALL_BOGUS_ANSWERS) {
+        return "ESERVFAIL";
+    }
+    getdns_list* replies = NULL;
+    getdns_dict* reply = NULL;
+    getdns_dict* header = NULL;
+    uint32_t rcode = GETDNS_RCODE_NOERROR;
+    if (getdns_dict_get_list(response, "replies_tree", &replies) == GETDNS_RETURN_GOOD &&
+        getdns_list_get_dict(replies, 0, &reply) == GETDNS_RETURN_GOOD &&
+        getdns_dict_get_dict(reply, "header", &header) == GETDNS_RETURN_GOOD) {
+        getdns_dict_get_int(header, "rcode", &rcode);
+    }
+    switch (rcode) {
+        case GETDNS_RCODE_NOERROR:
+            return "ENODATA";
+        case GETDNS_RCODE_FORMERR:
+            return "EFORMERR";
+        case GETDNS_RCODE_SERVFAIL:
+            return "ESERVFAIL";
+        case GETDNS_RCODE_NXDOMAIN:
+            return "ENOTFOUND";
+        case GETDNS_RCODE_NOTIMP:
+            return "ENOTIMP";
+        case GETDNS_RCODE_REFUSED:
+            return "EREFUSED";
+        default:
+            return "EBADRESP";
+    }
+}
+
+Local<Value> GNRecords::makeErrorObj(getdns_callback_type_t cbType, getdns_dict* response) {
+    Nan::EscapableHandleScope scope;
+    uint32_t status = 0;
+    const char* dnsCode = dnsErrorCode(cbType, response, &status);
+    Local<Object> err = Nan::To<Object>(GNUtil::makeErrorObj("Lookup failed.", (int) status)).ToLocalChecked();
+    setValue(err, "dnsCode", Nan::New<String>(dnsCode).ToLocalChecked());
+    return scope.Escape(err);
+}
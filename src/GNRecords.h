@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_RECORDS_H_
+#define _GN_RECORDS_H_
+
+#include <node.h>
+#include <nan.h>
+#include <getdns/getdns.h>
+
+// Converts responses straight to the record shapes of node's dns
+// resolve*() functions, instead of the generic response object tree.
+class GNRecords {
+public:
+    // Whether a type has a record shape
+    static bool isSupported(uint16_t type);
+
+    // The answers of one type as node's dns module shapes them:
+    // A/AAAA are address strings, or { address, ttl } with withTtl,
+    // MX { priority, exchange }, TXT arrays of strings,
+    // SRV { priority, weight, port, name }, SOA a single object and
+    // PTR/NS/CNAME names. Null when there are no answers of the type.
+    static v8::Local<v8::Value> shape(getdns_dict* response, uint16_t type, bool withTtl);
+
+    // An error object for a failed or empty lookup. Besides msg and
+    // code it has dnsCode, the matching node dns error code.
+    static v8::Local<v8::Value> makeErrorObj(getdns_callback_type_t cbType, getdns_dict* response);
+
+private:
+    // utility class
+    GNRecords() { }
+    ~GNRecords() { }
+    GNRecords(const GNRecords&);
+    void operator=(const GNRecords&);
+};
+
+#endif
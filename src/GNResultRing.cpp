@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNResultRing.h"
+#include "GNContext.h"
+#include "GNUtil.h"
+
+#include <string.h>
+
+using namespace v8;
+
+// Index counters are free running uint32s, shared with JS as int32s
+static inline uint32_t loadAcquire(int32_t* slot) {
+    return (uint32_t) __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+static inline void storeRelease(int32_t* slot, uint32_t value) {
+    __atomic_store_n(slot, (int32_t) value, __ATOMIC_RELEASE);
+}
+
+static uint8_t* sharedData(Local<SharedArrayBuffer> buffer, size_t* length) {
+#if V8_MAJOR_VERSION > 7 || (V8_MAJOR_VERSION == 7 && V8_MINOR_VERSION >= 9)
+    std::shared_ptr<BackingStore> store = buffer->GetBackingStore();
+    *length = store->ByteLength();
+    return static_cast<uint8_t*>(store->Data());
+#else
+    SharedArrayBuffer::Contents contents = buffer->GetContents();
+    *length = contents.ByteLength();
+    return static_cast<uint8_t*>(contents.Data());
+#endif
+}
+
+GNResultRing::GNResultRing(GNContext* ctx) :
+    ctx_(ctx), pollInterval_(1), toClose_(0) {
+    uv_timer_init(uv_default_loop(), &poll_);
+    poll_.data = this;
+    uv_unref((uv_handle_t*) &poll_);
+    uv_check_init(uv_default_loop(), &check_);
+    check_.data = this;
+    uv_unref((uv_handle_t*) &check_);
+}
+
+GNResultRing::~GNResultRing() {
+    for (size_t i = 0; i < channels_.size(); ++i) {
+        Channel* channel = channels_[i];
+        if (channel->extension) {
+            getdns_dict_destroy(channel->extension);
+        }
+        channel->buffer.Reset();
+        channel->header.Reset();
+        delete channel;
+    }
+    notify_.Reset();
+}
+
+void GNResultRing::Notify() {
+    if (uv_is_active((uv_handle_t*) &check_)) {
+        GNResultRing::OnCheck(&check_);
+    }
+}
+
+void GNResultRing::Close() {
+    uv_timer_stop(&poll_);
+    uv_check_stop(&check_);
+    toClose_ = 2;
+    uv_close((uv_handle_t*) &poll_, GNResultRing::OnClosed);
+    uv_close((uv_handle_t*) &check_, GNResultRing::OnClosed);
+}
+
+void GNResultRing::OnClosed(uv_handle_t* handle) {
+    GNResultRing* ring = static_cast<GNResultRing*>(handle->data);
+    if (--ring->toClose_ == 0) {
+        delete ring;
+    }
+}
+
+// Free a detached channel once its last lookup has been written
+void GNResultRing::Release(Channel* channel) {
+    if (!channel->detached || channel->inFlight > 0) {
+        return;
+    }
+    for (size_t i = 0; i < channels_.size(); ++i) {
+        if (channels_[i] == channel) {
+            channels_.erase(channels_.begin() + i);
+            break;
+        }
+    }
+    if (channel->extension) {
+        getdns_dict_destroy(channel->extension);
+    }
+    channel->buffer.Reset();
+    channel->header.Reset();
+    delete channel;
+}
+
+// Issue the queued submissions of a channel, as long as their results
+// are sure to fit in the result ring
+void GNResultRing::Drain(Channel* channel) {
+    int32_t* hdr = channel->hdr;
+    uint32_t head = loadAcquire(&hdr[H_SUBMISSION_HEAD]);
+    uint32_t tail = loadAcquire(&hdr[H_SUBMISSION_TAIL]);
+    while (head != tail && ctx_->context_) {
+        uint32_t used = loadAcquire(&hdr[H_RESULT_TAIL]) - loadAcquire(&hdr[H_RESULT_HEAD]);
+        if (used + channel->inFlight >= channel->slots) {
+            break;
+        }
+        const uint8_t* slot = channel->submissions + (size_t) (head % channel->slots) * channel->slotSize;
+        uint32_t id = 0;
+        uint16_t type = 0, nameLength = 0;
+        memcpy(&id, slot, 4);
+        memcpy(&type, slot + 4, 2);
+        memcpy(&nameLength, slot + 6, 2);
+        std::string name((const char*) slot + SUBMISSION_HEADER_SIZE,
+                         std::min<size_t>(nameLength, channel->slotSize - SUBMISSION_HEADER_SIZE));
+        head++;
+        storeRelease(&hdr[H_SUBMISSION_HEAD], head);
+
+        RingQuery* query = new RingQuery();
+        query->ring = this;
+        query->channel = channel;
+        query->id = id;
+        query->type = type;
+        channel->inFlight++;
+        ctx_->Ref();
+
+        getdns_transaction_t transId;
+        getdns_return_t r = ctx_->General(name.c_str(), type, channel->extension,
+                                          query, &transId, GNResultRing::Callback);
+        if (r != GETDNS_RETURN_GOOD) {
+            channel->inFlight--;
+            ctx_->Unref();
+            delete query;
+            Write(channel, id, type, r, NULL);
+        }
+        if (head == tail) {
+            tail = loadAcquire(&hdr[H_SUBMISSION_TAIL]);
+        }
+    }
+}
+
+void GNResultRing::Write(Channel* channel, uint32_t id, uint16_t type, uint32_t status, getdns_dict* response) {
+    int32_t* hdr = channel->hdr;
+    uint32_t tail = loadAcquire(&hdr[H_RESULT_TAIL]);
+    if (tail - loadAcquire(&hdr[H_RESULT_HEAD]) >= channel->slots) {
+        __atomic_fetch_add(&hdr[H_DROPPED], 1, __ATOMIC_RELAXED);
+        return;
+    }
+    uint8_t* slot = channel->results + (size_t) (tail % channel->slots) * channel->slotSize;
+    uint8_t* payload = slot + RESULT_HEADER_SIZE;
+    size_t capacity = channel->slotSize - RESULT_HEADER_SIZE;
+    uint32_t length = 0;
+    uint32_t ttl = 0;
+    uint16_t flags = 0;
+    bool haveTtl = false;
+
+    if (response && channel->wire) {
+        getdns_list* replies = NULL;
+        getdns_bindata* wire = NULL;
+        flags |= FLAG_WIRE;
+        if (getdns_dict_get_list(response, "replies_full", &replies) == GETDNS_RETURN_GOOD &&
+            getdns_list_get_bindata(replies, 0, &wire) == GETDNS_RETURN_GOOD) {
+            length = (uint32_t) std::min(wire->size, capacity);
+            if (length < wire->size) {
+                flags |= FLAG_TRUNCATED;
+            }
+            memcpy(payload, wire->data, length);
+        }
+        GNUtil::forEachRR(response, "answer", [&](getdns_dict* rr, uint32_t rrType) {
+            uint32_t rrTtl = 0;
+            getdns_dict_get_int(rr, "ttl", &rrTtl);
+            ttl = haveTtl ? std::min(ttl, rrTtl) : rrTtl;
+            haveTtl = true;
+        });
+    } else if (response) {
+        GNUtil::forEachRR(response, "answer", [&](getdns_dict* rr, uint32_t rrType) {
+            getdns_dict* rdata = NULL;
+            getdns_bindata* addr = NULL;
+            uint32_t rrTtl = 0;
+            if ((rrType != GETDNS_RRTYPE_A && rrType != GETDNS_RRTYPE_AAAA) ||
+                getdns_dict_get_dict(rr, "rdata", &rdata) != GETDNS_RETURN_GOOD ||
+                getdns_dict_get_bindata(rdata, rrType == GETDNS_RRTYPE_A ? "ipv4_address" : "ipv6_address", &addr) != GETDNS_RETURN_GOOD) {
+                return;
+            }
+            if (length + 1 + addr->size > capacity) {
+                flags |= FLAG_TRUNCATED;
+                return;
+            }
+            payload[length] = rrType == GETDNS_RRTYPE_A ? 4 : 6;
+            memcpy(payload + length + 1, addr->data, addr->size);
+            length += 1 + addr->size;
+            getdns_dict_get_int(rr, "ttl", &rrTtl);
+            ttl = haveTtl ? std::min(ttl, rrTtl) : rrTtl;
+            haveTtl = true;
+        });
+    }
+
+    memcpy(slot, &id, 4);
+    memcpy(slot + 4, &status, 4);
+    memcpy(slot + 8, &ttl, 4);
+    memcpy(slot + 12, &type, 2);
+    memcpy(slot + 14, &flags, 2);
+    memcpy(slot + 16, &length, 4);
+    storeRelease(&hdr[H_RESULT_TAIL], tail + 1);
+
+    // wake the worker once this loop iteration is done
+    channel->notify = true;
+    uv_check_start(&check_, GNResultRing::OnCheck);
+}
+
+void GNResultRing::Callback(getdns_context* context,
+                            getdns_callback_type_t cbType,
+                            getdns_dict* response,
+                            void* userArg,
+                            getdns_transaction_t transId) {
+    RingQuery* query = static_cast<RingQuery*>(userArg);
+    GNResultRing* ring = query->ring;
+    Channel* channel = query->channel;
+    uint32_t status = cbType;
+    if (cbType == GETDNS_CALLBACK_COMPLETE && response) {
+        getdns_dict_get_int(response, "status", &status);
+    }
+    ring->Write(channel, query->id, query->type, status,
+                cbType == GETDNS_CALLBACK_COMPLETE ? response : NULL);
+    if (response) {
+        getdns_dict_destroy(response);
+    }
+    channel->inFlight--;
+    ring->Release(channel);
+    ring->ctx_->Unref();
+    delete query;
+}
+
+void GNResultRing::OnPoll(uv_timer_t* handle) {
+    Nan::HandleScope scope;
+    GNResultRing* ring = static_cast<GNResultRing*>(handle->data);
+    // NOTE: channels may be released while issuing, when a lookup fails
+    std::vector<Channel*> channels(ring->channels_);
+    for (size_t i = 0; i < channels.size(); ++i) {
+        if (!channels[i]->detached) {
+            ring->Drain(channels[i]);
+        }
+    }
+}
+
+// Atomics.notify the result tail of every channel written to
+void GNResultRing::OnCheck(uv_check_t* handle) {
+    Nan::HandleScope scope;
+    GNResultRing* ring = static_cast<GNResultRing*>(handle->data);
+    uv_check_stop(&ring->check_);
+    if (ring->notify_.IsEmpty()) {
+        Local<Object> atomics = Nan::To<Object>(Nan::Get(Nan::GetCurrentContext()->Global(),
+            Nan::New<String>("Atomics").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+        Local<Value> notify = Nan::Get(atomics, Nan::New<String>("notify").ToLocalChecked()).ToLocalChecked();
+        ring->notify_.Reset(Local<Function>::Cast(notify));
+    }
+    Local<Function> notify = Nan::New(ring->notify_);
+    for (size_t i = 0; i < ring->channels_.size(); ++i) {
+        Channel* channel = ring->channels_[i];
+        if (!channel->notify) {
+            continue;
+        }
+        channel->notify = false;
+        Local<Value> argv[] = { Nan::New(channel->header), Nan::New<Integer>(H_RESULT_TAIL) };
+        Nan::TryCatch try_catch;
+        Nan::Call(notify, Nan::GetCurrentContext()->Global(), 2, argv);
+    }
+}
+
+// Handle ctx.attachRing(sharedArrayBuffer, [options])
+NAN_METHOD(GNResultRing::Attach) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        return Nan::ThrowError(Nan::New<String>("Context is invalid.").ToLocalChecked());
+    }
+    if (info.Length() < 1 || !info[0]->IsSharedArrayBuffer()) {
+        return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("ring", GETDNS_RETURN_INVALID_PARAMETER));
+    }
+    Local<SharedArrayBuffer> buffer = Local<SharedArrayBuffer>::Cast(info[0]);
+    size_t length = 0;
+    uint8_t* data = sharedData(buffer, &length);
+    int32_t* hdr = reinterpret_cast<int32_t*>(data);
+    uint32_t slots = length >= HEADER_SIZE ? (uint32_t) hdr[H_SLOTS] : 0;
+    uint32_t slotSize = length >= HEADER_SIZE ? (uint32_t) hdr[H_SLOT_SIZE] : 0;
+    // slots must divide 2^32 for the free running counters
+    if (length < HEADER_SIZE || hdr[H_MAGIC] != MAGIC ||
+        slots < 2 || (slots & (slots - 1)) != 0 ||
+        slotSize < 64 || slotSize % 8 != 0 ||
+        length < HEADER_SIZE + 2 * (uint64_t) slots * slotSize) {
+        return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("ring", GETDNS_RETURN_INVALID_PARAMETER));
+    }
+
+    bool wire = false;
+    getdns_dict* extension = NULL;
+    if (!ctx->ring_) {
+        ctx->ring_ = new GNResultRing(ctx);
+    }
+    GNResultRing* ring = ctx->ring_;
+    if (info.Length() > 1 && info[1]->IsObject()) {
+        Local<Object> options = Nan::To<Object>(info[1]).ToLocalChecked();
+        Local<Value> format = Nan::Get(options, Nan::New<String>("format").ToLocalChecked()).ToLocalChecked();
+        Local<Value> pollInterval = Nan::Get(options, Nan::New<String>("pollInterval").ToLocalChecked()).ToLocalChecked();
+        Local<Value> extensions = Nan::Get(options, Nan::New<String>("extensions").ToLocalChecked()).ToLocalChecked();
+        if (!format->IsUndefined()) {
+            Nan::Utf8String formatStr(format);
+            if (strcmp(*formatStr, "wire") == 0) {
+                wire = true;
+            } else if (strcmp(*formatStr, "addresses") != 0) {
+                return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("format", GETDNS_RETURN_INVALID_PARAMETER));
+            }
+        }
+        if (!pollInterval->IsUndefined()) {
+            if (!pollInterval->IsNumber() || Nan::To<double>(pollInterval).FromJust() < 1) {
+                return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("pollInterval", GETDNS_RETURN_INVALID_PARAMETER));
+            }
+            ring->pollInterval_ = (uint64_t) Nan::To<double>(pollInterval).FromJust();
+        }
+        if (extensions->IsObject()) {
+            extension = GNUtil::convertToDict(Nan::To<Object>(extensions).ToLocalChecked());
+        }
+    }
+    for (size_t i = 0; i < ring->channels_.size(); ++i) {
+        if (!ring->channels_[i]->detached && ring->channels_[i]->buffer == buffer) {
+            if (extension) {
+                getdns_dict_destroy(extension);
+            }
+            return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("ring", GETDNS_RETURN_INVALID_PARAMETER));
+        }
+    }
+
+    Channel* channel = new Channel();
+    channel->buffer.Reset(buffer);
+    channel->header.Reset(Int32Array::New(buffer, 0, HEADER_SIZE / 4));
+    channel->hdr = hdr;
+    channel->submissions = data + HEADER_SIZE;
+    channel->results = data + HEADER_SIZE + (size_t) slots * slotSize;
+    channel->slots = slots;
+    channel->slotSize = slotSize;
+    channel->wire = wire;
+    channel->extension = extension;
+    channel->inFlight = 0;
+    channel->detached = false;
+    channel->notify = false;
+    ring->channels_.push_back(channel);
+
+    uv_timer_start(&ring->poll_, GNResultRing::OnPoll, 0, ring->pollInterval_);
+}
+
+// Handle ctx.detachRing(sharedArrayBuffer). Lookups in flight still
+// write their results.
+NAN_METHOD(GNResultRing::Detach) {
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->ring_ || info.Length() < 1 || !info[0]->IsSharedArrayBuffer()) {
+        info.GetReturnValue().Set(Nan::False());
+        return;
+    }
+    GNResultRing* ring = ctx->ring_;
+    Local<SharedArrayBuffer> buffer = Local<SharedArrayBuffer>::Cast(info[0]);
+    bool found = false;
+    bool active = false;
+    std::vector<Channel*> channels(ring->channels_);
+    for (size_t i = 0; i < channels.size(); ++i) {
+        Channel* channel = channels[i];
+        if (!channel->detached && channel->buffer == buffer) {
+            channel->detached = true;
+            found = true;
+            ring->Release(channel);
+        } else if (!channel->detached) {
+            active = true;
+        }
+    }
+    if (!active) {
+        uv_timer_stop(&ring->poll_);
+    }
+    info.GetReturnValue().Set(found ? Nan::True() : Nan::False());
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_RESULT_RING_H_
+#define _GN_RESULT_RING_H_
+
+#include <node.h>
+#include <nan.h>
+#include <uv.h>
+#include <getdns/getdns.h>
+
+#include <vector>
+
+class GNContext;
+
+// Serves lookups to other threads through SharedArrayBuffer channels,
+// without postMessage. Each channel holds two single producer, single
+// consumer rings of fixed size slots: submissions written by one worker
+// and results written by the context. The context polls the submission
+// rings on a timer, writes compact binary results and wakes the worker
+// with Atomics.notify once per loop iteration.
+//
+// Layout, all integers little endian:
+//   header     16 int32: magic, slots, slotSize, submission head and
+//              tail, result head and tail, dropped results, reserved
+//   submissions slots * slotSize: u32 id, u16 type, u16 name length,
+//              name
+//   results    slots * slotSize: u32 id, u32 status, u32 ttl, u16 type,
+//              u16 flags, u32 length, then the addresses as u8 family
+//              (4 or 6) and address bytes, or the wire format response
+class GNResultRing {
+public:
+    enum {
+        MAGIC = 0x474e5231,
+        HEADER_SIZE = 64,
+        SUBMISSION_HEADER_SIZE = 8,
+        RESULT_HEADER_SIZE = 20
+    };
+
+    // int32 indexes in the header
+    enum {
+        H_MAGIC = 0,
+        H_SLOTS,
+        H_SLOT_SIZE,
+        H_SUBMISSION_HEAD,
+        H_SUBMISSION_TAIL,
+        H_RESULT_HEAD,
+        H_RESULT_TAIL,
+        H_DROPPED
+    };
+
+    // result flags
+    enum {
+        FLAG_WIRE = 1,
+        FLAG_TRUNCATED = 2
+    };
+
+    // ctx.attachRing(sharedArrayBuffer, [options])
+    static NAN_METHOD(Attach);
+    // ctx.detachRing(sharedArrayBuffer)
+    static NAN_METHOD(Detach);
+
+    // Wake the workers of results written since the last notification,
+    // right away rather than at the end of the loop iteration
+    void Notify();
+
+    // Stop polling and free once the handles are closed
+    void Close();
+
+private:
+    typedef struct Channel {
+        Nan::Persistent<v8::SharedArrayBuffer> buffer;
+        Nan::Persistent<v8::Int32Array> header;
+        int32_t* hdr;
+        uint8_t* submissions;
+        uint8_t* results;
+        uint32_t slots;
+        uint32_t slotSize;
+        bool wire;
+        getdns_dict* extension;
+        size_t inFlight;
+        bool detached;
+        bool notify;
+    } Channel;
+
+    typedef struct RingQuery {
+        GNResultRing* ring;
+        Channel* channel;
+        uint32_t id;
+        uint16_t type;
+    } RingQuery;
+
+    explicit GNResultRing(GNContext* ctx);
+    ~GNResultRing();
+
+    void Drain(Channel* channel);
+    void Write(Channel* channel, uint32_t id, uint16_t type, uint32_t status, getdns_dict* response);
+    void Release(Channel* channel);
+
+    static void OnPoll(uv_timer_t* handle);
+    static void OnCheck(uv_check_t* handle);
+    static void OnClosed(uv_handle_t* handle);
+    static void Callback(getdns_context* context,
+                         getdns_callback_type_t cbType,
+                         getdns_dict* response,
+                         void* userArg,
+                         getdns_transaction_t transId);
+
+    GNContext* ctx_;
+    std::vector<Channel*> channels_;
+    uv_timer_t poll_;
+    uv_check_t check_;
+    uint64_t pollInterval_;
+    int toClose_;
+    Nan::Persistent<v8::Function> notify_;
+};
+
+#endif
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNReverseSweep.h"
+#include "GNContext.h"
+#include "GNUtil.h"
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace v8;
+
+static const size_t DEFAULT_CONCURRENCY = 100;
+static const size_t DEFAULT_BATCH_SIZE = 256;
+
+// Refuse blocks with more host bits than this, a /64 would never finish.
+static const int MAX_HOST_BITS = 32;
+
+// Per query user arg
+typedef struct SweepQuery {
+    GNReverseSweep* sweep;
+    int family;
+    uint8_t addr[16];
+} SweepQuery;
+
+// Build the in-addr.arpa or ip6.arpa name for an address
+static std::string reverseName(int family, const uint8_t* addr) {
+    static const char hex[] = "0123456789abcdef";
+    std::string name;
+    if (family == AF_INET) {
+        for (int i = 3; i >= 0; --i) {
+            name.append(std::to_string(addr[i]));
+            name.push_back('.');
+        }
+        name.append("in-addr.arpa.");
+    } else {
+        for (int i = 15; i >= 0; --i) {
+            name.push_back(hex[addr[i] & 0xf]);
+            name.push_back('.');
+            name.push_back(hex[addr[i] >> 4]);
+            name.push_back('.');
+        }
+        name.append("ip6.arpa.");
+    }
+    return name;
+}
+
+// First PTR target in the answer section, or NULL. Must be freed by the user
+static char* firstPtrName(getdns_dict* response) {
+    char* fqdn = NULL;
+    GNUtil::forEachRR(response, "answer", [&fqdn](getdns_dict* rr, uint32_t type) {
+        getdns_dict* rdata = NULL;
+        getdns_bindata* ptrdname = NULL;
+        if (fqdn || type != GETDNS_RRTYPE_PTR ||
+            getdns_dict_get_dict(rr, "rdata", &rdata) != GETDNS_RETURN_GOOD ||
+            getdns_dict_get_bindata(rdata, "ptrdname", &ptrdname) != GETDNS_RETURN_GOOD) {
+            return;
+        }
+        getdns_convert_dns_name_to_fqdn(ptrdname, &fqdn);
+    });
+    return fqdn;
+}
+
+GNReverseSweep::GNReverseSweep(GNContext* ctx, Nan::Callback* onBatch, Nan::Callback* callback) :
+    ctx_(ctx), onBatch_(onBatch), callback_(callback), extension_(NULL),
+    concurrency_(DEFAULT_CONCURRENCY), batchSize_(DEFAULT_BATCH_SIZE),
+    range_(0), inflight_(0), pumping_(false), finished_(false), aborted_(false),
+    error_(GETDNS_RETURN_GOOD),
+    queried_(0), found_(0), failed_(0) { }
+
+GNReverseSweep::~GNReverseSweep() {
+    if (extension_) {
+        getdns_dict_destroy(extension_);
+    }
+    delete onBatch_;
+    delete callback_;
+}
+
+// Accepts "192.0.2.0/24", "2001:db8::/112" or a single address
+bool GNReverseSweep::ParseCidr(const char* cidr, Range& range) {
+    char addrStr[INET6_ADDRSTRLEN + 1];
+    const char* slash = strchr(cidr, '/');
+    size_t addrLen = slash ? (size_t) (slash - cidr) : strlen(cidr);
+    if (addrLen == 0 || addrLen > INET6_ADDRSTRLEN) {
+        return false;
+    }
+    memcpy(addrStr, cidr, addrLen);
+    addrStr[addrLen] = 0;
+
+    memset(range.base, 0, sizeof(range.base));
+    int maxBits = 0;
+    if (inet_pton(AF_INET, addrStr, range.base) == 1) {
+        range.family = AF_INET;
+        maxBits = 32;
+    } else if (inet_pton(AF_INET6, addrStr, range.base) == 1) {
+        range.family = AF_INET6;
+        maxBits = 128;
+    } else {
+        return false;
+    }
+
+    int prefix = maxBits;
+    if (slash) {
+        char* end = NULL;
+        long parsed = strtol(slash + 1, &end, 10);
+        if (end == slash + 1 || *end != 0 || parsed < 0 || parsed > maxBits) {
+            return false;
+        }
+        prefix = (int) parsed;
+    }
+    int hostBits = maxBits - prefix;
+    if (hostBits > MAX_HOST_BITS) {
+        return false;
+    }
+    // clear the host part
+    for (int bit = prefix; bit < maxBits; ++bit) {
+        range.base[bit / 8] &= (uint8_t) ~(0x80 >> (bit % 8));
+    }
+    range.count = ((uint64_t) 1) << hostBits;
+    range.next = 0;
+    return true;
+}
+
+bool GNReverseSweep::NextAddress(int& family, uint8_t* addr) {
+    while (range_ < ranges_.size()) {
+        Range& range = ranges_[range_];
+        if (range.next < range.count) {
+            size_t size = range.family == AF_INET ? 4 : 16;
+            uint64_t carry = range.next++;
+            memcpy(addr, range.base, size);
+            for (size_t i = size; i > 0 && carry; --i) {
+                carry += addr[i - 1];
+                addr[i - 1] = (uint8_t) (carry & 0xff);
+                carry >>= 8;
+            }
+            family = range.family;
+            return true;
+        }
+        range_++;
+    }
+    return false;
+}
+
+void GNReverseSweep::Pump() {
+    if (pumping_) {
+        return;
+    }
+    pumping_ = true;
+    while (!aborted_ && inflight_ < concurrency_) {
+        if (!ctx_->context_) {
+            // context was destroyed underneath us
+            aborted_ = true;
+            break;
+        }
+        SweepQuery* query = new SweepQuery();
+        query->sweep = this;
+        if (!NextAddress(query->family, query->addr)) {
+            delete query;
+            break;
+        }
+        std::string name = reverseName(query->family, query->addr);
+
+        queried_++;
+        inflight_++;
+        getdns_transaction_t transId;
+        getdns_return_t r = ctx_->General(name.c_str(), GETDNS_RRTYPE_PTR,
+                                          extension_, query, &transId,
+                                          GNReverseSweep::Callback,
+                                          GNScheduler::Bulk);
+        if (r != GETDNS_RETURN_GOOD) {
+            // NOTE: a draining or rate limited context refuses the rest
+            // of the range as well, so stop rather than walk it
+            inflight_--;
+            failed_++;
+            delete query;
+            error_ = r;
+            aborted_ = true;
+        }
+    }
+    pumping_ = false;
+    MaybeFinish();
+}
+
+void GNReverseSweep::Callback(getdns_context* context,
+                              getdns_callback_type_t cbType,
+                              getdns_dict* response,
+                              void* userArg,
+                              getdns_transaction_t transId) {
+    SweepQuery* query = static_cast<SweepQuery*>(userArg);
+    GNReverseSweep* sweep = query->sweep;
+    sweep->inflight_--;
+    if (cbType == GETDNS_CALLBACK_COMPLETE) {
+        char* hostname = response ? firstPtrName(response) : NULL;
+        if (hostname) {
+            char addrStr[INET6_ADDRSTRLEN];
+            Hit hit;
+            inet_ntop(query->family, query->addr, addrStr, sizeof(addrStr));
+            hit.address = addrStr;
+            hit.hostname = hostname;
+            free(hostname);
+            sweep->batch_.push_back(hit);
+            sweep->found_++;
+        }
+    } else {
+        sweep->failed_++;
+    }
+    if (response) {
+        getdns_dict_destroy(response);
+    }
+    delete query;
+
+    if (sweep->batch_.size() >= sweep->batchSize_) {
+        sweep->FlushBatch();
+    }
+    sweep->Pump();
+}
+
+// Hand the collected hits to onBatch; returning false from it stops the sweep.
+void GNReverseSweep::FlushBatch() {
+    if (batch_.empty()) {
+        return;
+    }
+    Nan::HandleScope scope;
+    Local<Array> pairs = Nan::New<Array>(batch_.size());
+    Local<String> addressKey = Nan::New<String>("address").ToLocalChecked();
+    Local<String> hostnameKey = Nan::New<String>("hostname").ToLocalChecked();
+    for (size_t i = 0; i < batch_.size(); ++i) {
+        Local<Object> pair = Nan::New<Object>();
+        Nan::Set(pair, addressKey, Nan::New<String>(batch_[i].address).ToLocalChecked());
+        Nan::Set(pair, hostnameKey, Nan::New<String>(batch_[i].hostname).ToLocalChecked());
+        Nan::Set(pairs, i, pair);
+    }
+    batch_.clear();
+
+    Local<Value> argv[] = { pairs };
+    Nan::TryCatch try_catch;
+    Local<Value> result = onBatch_->Call(Nan::GetCurrentContext()->Global(), 1, argv);
+    if (try_catch.HasCaught())
+        Nan::FatalException(try_catch);
+    if (!result.IsEmpty() && result->IsFalse()) {
+        aborted_ = true;
+    }
+}
+
+void GNReverseSweep::MaybeFinish() {
+    if (finished_ || pumping_ || inflight_) {
+        return;
+    }
+    if (!aborted_ && range_ < ranges_.size()) {
+        return;
+    }
+    FlushBatch();
+    finished_ = true;
+
+    Nan::HandleScope scope;
+    Local<Value> argv[2];
+    if (!ctx_->context_) {
+        argv[0] = GNUtil::makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
+    } else if (error_ != GETDNS_RETURN_GOOD) {
+        argv[0] = GNUtil::makeErrorObj("Error issuing query", error_);
+    } else {
+        argv[0] = Nan::Null();
+    }
+    Local<Object> stats = Nan::New<Object>();
+    Nan::Set(stats, Nan::New<String>("queried").ToLocalChecked(), Nan::New<Number>((double) queried_));
+    Nan::Set(stats, Nan::New<String>("found").ToLocalChecked(), Nan::New<Number>((double) found_));
+    Nan::Set(stats, Nan::New<String>("failed").ToLocalChecked(), Nan::New<Number>((double) failed_));
+    argv[1] = stats;
+
+    Nan::TryCatch try_catch;
+    callback_->Call(Nan::GetCurrentContext()->Global(), 2, argv);
+    if (try_catch.HasCaught())
+        Nan::FatalException(try_catch);
+
+    ctx_->Unref();
+    delete this;
+}
+
+// Handle ctx.reverseSweep(cidrs, [options], onBatch, callback)
+NAN_METHOD(GNReverseSweep::Start) {
+    if (info.Length() < 3) {
+        return Nan::ThrowTypeError(Nan::New<String>("At least 3 arguments are required.").ToLocalChecked());
+    }
+    // last two args must be callbacks
+    Local<Value> last = info[info.Length() - 1];
+    Local<Value> batchFn = info[info.Length() - 2];
+    if (!last->IsFunction() || !batchFn->IsFunction()) {
+        return Nan::ThrowTypeError(Nan::New<String>("Final two arguments must be functions.").ToLocalChecked());
+    }
+    Local<Function> localCb = Local<Function>::Cast(last);
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        Local<Value> err = GNUtil::makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        return;
+    }
+    // first arg is a CIDR string or an array of them
+    std::vector<Range> ranges;
+    Local<Array> cidrs;
+    if (info[0]->IsArray()) {
+        cidrs = Local<Array>::Cast(info[0]);
+    } else {
+        cidrs = Nan::New<Array>(1);
+        Nan::Set(cidrs, 0, info[0]);
+    }
+    for (uint32_t i = 0; i < cidrs->Length(); ++i) {
+        Local<Value> cidr = Nan::Get(cidrs, i).ToLocalChecked();
+        Range range;
+        if (!cidr->IsString()) {
+            return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("cidr", GETDNS_RETURN_INVALID_PARAMETER));
+        }
+        Nan::Utf8String cidrStr(cidr);
+        if (!GNReverseSweep::ParseCidr(*cidrStr, range)) {
+            return Nan::ThrowError(GNUtil::makeTypeErrorWithCode(*cidrStr, GETDNS_RETURN_INVALID_PARAMETER));
+        }
+        ranges.push_back(range);
+    }
+
+    // optional options object
+    size_t concurrency = DEFAULT_CONCURRENCY;
+    size_t batchSize = DEFAULT_BATCH_SIZE;
+    getdns_dict* extension = NULL;
+    if (info.Length() > 3 && GNUtil::isDictionaryObject(info[1])) {
+        Local<Object> opts = Nan::To<v8::Object>(info[1]).ToLocalChecked();
+        Local<Value> val = Nan::Get(opts, Nan::New<String>("concurrency").ToLocalChecked()).ToLocalChecked();
+        if (!val->IsUndefined()) {
+            if (!val->IsNumber() || Nan::To<uint32_t>(val).FromJust() == 0) {
+                return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("concurrency", GETDNS_RETURN_INVALID_PARAMETER));
+            }
+            concurrency = Nan::To<uint32_t>(val).FromJust();
+        }
+        val = Nan::Get(opts, Nan::New<String>("batchSize").ToLocalChecked()).ToLocalChecked();
+        if (!val->IsUndefined()) {
+            if (!val->IsNumber() || Nan::To<uint32_t>(val).FromJust() == 0) {
+                return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("batchSize", GETDNS_RETURN_INVALID_PARAMETER));
+            }
+            batchSize = Nan::To<uint32_t>(val).FromJust();
+        }
+        val = Nan::Get(opts, Nan::New<String>("extensions").ToLocalChecked()).ToLocalChecked();
+        if (val->IsObject()) {
+            extension = GNUtil::convertToDict(Nan::To<v8::Object>(val).ToLocalChecked());
+        }
+    }
+
+    GNReverseSweep* sweep = new GNReverseSweep(ctx,
+        new Nan::Callback(Local<Function>::Cast(batchFn)), new Nan::Callback(localCb));
+    sweep->ranges_.swap(ranges);
+    sweep->concurrency_ = concurrency;
+    sweep->batchSize_ = batchSize;
+    sweep->extension_ = extension;
+    ctx->Ref();
+    sweep->Pump();
+    info.GetReturnValue().Set(Nan::True());
+}
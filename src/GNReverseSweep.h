@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_REVERSE_SWEEP_H_
+#define _GN_REVERSE_SWEEP_H_
+
+#include <node.h>
+#include <nan.h>
+#include <getdns/getdns.h>
+
+#include <string>
+#include <vector>
+
+class GNContext;
+
+// Walks CIDR blocks, issuing PTR queries with a concurrency cap, and
+// hands the (address, hostname) results back to JS in batches.
+class GNReverseSweep {
+public:
+    // ctx.reverseSweep(cidrs, [options], onBatch, callback)
+    static NAN_METHOD(Start);
+
+private:
+    // One CIDR block, iterated from its first address
+    typedef struct Range {
+        int family;
+        uint8_t base[16];
+        uint64_t count;
+        uint64_t next;
+    } Range;
+
+    typedef struct Hit {
+        std::string address;
+        std::string hostname;
+    } Hit;
+
+    GNReverseSweep(GNContext* ctx, Nan::Callback* onBatch, Nan::Callback* callback);
+    ~GNReverseSweep();
+
+    static bool ParseCidr(const char* cidr, Range& range);
+    bool NextAddress(int& family, uint8_t* addr);
+
+    void Pump();
+    void FlushBatch();
+    void MaybeFinish();
+    static void Callback(getdns_context* context,
+                         getdns_callback_type_t cbType,
+                         getdns_dict* response,
+                         void* userArg,
+                         getdns_transaction_t transId);
+
+    GNContext* ctx_;
+    Nan::Callback* onBatch_;
+    Nan::Callback* callback_;
+    getdns_dict* extension_;
+    size_t concurrency_;
+    size_t batchSize_;
+
+    std::vector<Range> ranges_;
+    size_t range_;
+    std::vector<Hit> batch_;
+
+    size_t inflight_;
+    bool pumping_;
+    bool finished_;
+    bool aborted_;
+    // why lookups could not be issued, GETDNS_RETURN_GOOD while they can
+    getdns_return_t error_;
+
+    // Counters reported to the final callback
+    uint64_t queried_;
+    uint64_t found_;
+    uint64_t failed_;
+};
+
+#endif
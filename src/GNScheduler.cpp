@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNScheduler.h"
+#include "GNContext.h"
+#include "GNUtil.h"
+
+#include <string.h>
+
+using namespace v8;
+
+static const char* PRIORITY_NAMES[GNScheduler::NumPriorities] = {
+    "interactive",
+    "normal",
+    "bulk"
+};
+
+GNScheduler::GNScheduler(GNContext* ctx) :
+    ctx_(ctx), limit_(0), running_(0), nextId_(0),
+    dispatching_(NULL), dispatchingDone_(false), pumping_(false), repump_(false), stopped_(false),
+    rate_(0), burst_(0), tokens_(0), refilledAt_(0), failWhenLimited_(false), limited_(0), rejected_(0) {
+    memset(classes_, 0, sizeof(classes_));
+    uv_timer_init(uv_default_loop(), &timer_);
+    timer_.data = this;
+}
+
+GNScheduler::~GNScheduler() {
+    // NOTE: lookups hold a reference to the context, so none are left
+    std::unordered_map<getdns_transaction_t, Entry*>::iterator it;
+    for (it = entries_.begin(); it != entries_.end(); ++it) {
+        getdns_dict_destroy(it->second->args);
+        delete it->second;
+    }
+}
+
+static bool readLimit(Local<Object> options, const char* name, uint32_t* limit) {
+    Local<Value> value = Nan::Get(options, Nan::New<String>(name).ToLocalChecked()).ToLocalChecked();
+    if (value->IsUndefined()) {
+        return true;
+    }
+    if (!value->IsNumber() || !(Nan::To<double>(value).FromJust() >= 0)) {
+        return false;
+    }
+    *limit = Nan::To<uint32_t>(value).FromJust();
+    return true;
+}
+
+// Read { rate, burst, queue }: lookups per second, the size of the
+// bucket (rate by default, at least 1) and whether to queue lookups
+// over the rate (the default) or fail them
+static bool readRateLimit(Local<Object> options, double* rate, double* burst, bool* queue) {
+    Local<Value> rateValue = Nan::Get(options, Nan::New<String>("rate").ToLocalChecked()).ToLocalChecked();
+    Local<Value> burstValue = Nan::Get(options, Nan::New<String>("burst").ToLocalChecked()).ToLocalChecked();
+    Local<Value> queueValue = Nan::Get(options, Nan::New<String>("queue").ToLocalChecked()).ToLocalChecked();
+    if (!rateValue->IsNumber() || !(Nan::To<double>(rateValue).FromJust() > 0)) {
+        return false;
+    }
+    *rate = Nan::To<double>(rateValue).FromJust();
+    *burst = *rate < 1 ? 1 : *rate;
+    if (!burstValue->IsUndefined()) {
+        if (!burstValue->IsNumber() || !(Nan::To<double>(burstValue).FromJust() >= 1)) {
+            return false;
+        }
+        *burst = Nan::To<double>(burstValue).FromJust();
+    }
+    *queue = queueValue->IsUndefined() || Nan::To<bool>(queueValue).FromJust();
+    return true;
+}
+
+GNScheduler* GNScheduler::Create(GNContext* ctx, Local<Value> options, Local<Value> rateLimit) {
+    GNScheduler* scheduler = new GNScheduler(ctx);
+    const char* invalid = NULL;
+    if (!options->IsUndefined()) {
+        bool valid = GNUtil::isDictionaryObject(options);
+        if (valid) {
+            Local<Object> opts = Nan::To<Object>(options).ToLocalChecked();
+            for (int p = 0; p < NumPriorities && valid; ++p) {
+                valid = readLimit(opts, PRIORITY_NAMES[p], &scheduler->classes_[p].limit);
+            }
+            valid = valid && readLimit(opts, "total", &scheduler->limit_);
+        }
+        invalid = valid ? NULL : "scheduler";
+    }
+    if (!invalid && !rateLimit->IsUndefined()) {
+        bool queue = true;
+        if (!GNUtil::isDictionaryObject(rateLimit) ||
+            !readRateLimit(Nan::To<Object>(rateLimit).ToLocalChecked(), &scheduler->rate_, &scheduler->burst_, &queue)) {
+            invalid = "rate_limit";
+        }
+        scheduler->failWhenLimited_ = !queue;
+        // starts full
+        scheduler->tokens_ = scheduler->burst_;
+        scheduler->refilledAt_ = uv_hrtime();
+    }
+    if (invalid) {
+        scheduler->Close();
+        Nan::ThrowError(GNUtil::makeTypeErrorWithCode(invalid, GETDNS_RETURN_INVALID_PARAMETER));
+        return NULL;
+    }
+    return scheduler;
+}
+
+void GNScheduler::Close() {
+    uv_timer_stop(&timer_);
+    uv_close((uv_handle_t*) &timer_, GNScheduler::OnClosed);
+}
+
+void GNScheduler::OnClosed(uv_handle_t* handle) {
+    delete static_cast<GNScheduler*>(handle->data);
+}
+
+bool GNScheduler::ParsePriority(Local<Value> value, Priority* priority) {
+    if (!value->IsString()) {
+        return false;
+    }
+    Nan::Utf8String name(value);
+    for (int p = 0; p < NumPriorities; ++p) {
+        if (strcmp(*name, PRIORITY_NAMES[p]) == 0) {
+            *priority = (Priority) p;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GNScheduler::HasRoom(Priority priority) const {
+    const ClassStats& stats = classes_[priority];
+    return (stats.limit == 0 || stats.running < stats.limit) &&
+           (limit_ == 0 || running_ < limit_) &&
+           (rate_ == 0 || tokens_ >= 1);
+}
+
+void GNScheduler::Refill() {
+    if (rate_ == 0) {
+        return;
+    }
+    uint64_t now = uv_hrtime();
+    tokens_ += (now - refilledAt_) / 1e9 * rate_;
+    if (tokens_ > burst_) {
+        tokens_ = burst_;
+    }
+    refilledAt_ = now;
+}
+
+// Pump again once there is a token for the next queued lookup
+void GNScheduler::ArmRefill() {
+    if (rate_ == 0 || tokens_ >= 1 || uv_is_active((uv_handle_t*) &timer_)) {
+        return;
+    }
+    uint64_t wait = (uint64_t) ((1 - tokens_) / rate_ * 1000) + 1;
+    uv_timer_start(&timer_, GNScheduler::OnRefill, wait, 0);
+}
+
+void GNScheduler::OnRefill(uv_timer_t* handle) {
+    static_cast<GNScheduler*>(handle->data)->Pump();
+}
+
+getdns_return_t GNScheduler::Submit(GNEngine::QueryKind kind,
+                                    const char* name,
+                                    uint16_t type,
+                                    getdns_dict* address,
+                                    getdns_dict* extensions,
+                                    void* userArg,
+                                    getdns_transaction_t* transId,
+                                    getdns_callback_t callback,
+                                    Priority priority) {
+    if (stopped_) {
+        return GETDNS_RETURN_BAD_CONTEXT;
+    }
+    Refill();
+    bool overRate = rate_ != 0 && tokens_ < 1;
+    if (overRate && failWhenLimited_) {
+        rejected_++;
+        return (getdns_return_t) RATE_LIMITED;
+    }
+    Entry* entry = new Entry();
+    entry->scheduler = this;
+    entry->kind = kind;
+    entry->priority = priority;
+    entry->name = name ? name : "";
+    entry->type = type;
+    entry->args = NULL;
+    entry->userArg = userArg;
+    entry->callback = callback;
+    entry->id = ++nextId_;
+    entry->issuedId = 0;
+    entry->running = false;
+    entry->queuedAt = uv_hrtime();
+
+    // the queues of this and higher classes go first
+    bool waiting = false;
+    for (int p = 0; p <= priority; ++p) {
+        waiting = waiting || !queues_[p].empty();
+    }
+    if (!waiting && HasRoom(priority)) {
+        entries_[entry->id] = entry;
+        getdns_transaction_t id = entry->id;
+        getdns_return_t r = Dispatch(entry, address, extensions);
+        if (r != GETDNS_RETURN_GOOD) {
+            entries_.erase(id);
+            delete entry;
+            return r;
+        }
+        *transId = id;
+        return GETDNS_RETURN_GOOD;
+    }
+
+    entry->args = getdns_dict_create();
+    if (address) {
+        getdns_dict_set_dict(entry->args, "address", address);
+    }
+    if (extensions) {
+        getdns_dict_set_dict(entry->args, "extensions", extensions);
+    }
+    entry->position = queues_[priority].insert(queues_[priority].end(), entry);
+    entries_[entry->id] = entry;
+    *transId = entry->id;
+    if (overRate) {
+        limited_++;
+        ArmRefill();
+    }
+    return GETDNS_RETURN_GOOD;
+}
+
+// Issue an entry, which may call back before this returns
+getdns_return_t GNScheduler::Dispatch(Entry* entry, getdns_dict* address, getdns_dict* extensions) {
+    ClassStats& stats = classes_[entry->priority];
+    uint64_t wait = uv_hrtime() - entry->queuedAt;
+    stats.dispatched++;
+    stats.waitTotal += wait;
+    if (wait > stats.waitMax) {
+        stats.waitMax = wait;
+    }
+    stats.running++;
+    running_++;
+    entry->running = true;
+    if (rate_ != 0) {
+        tokens_ -= 1;
+    }
+
+    getdns_transaction_t issuedId = 0;
+    // NOTE: saved, as a lookup that completes right away may dispatch others
+    Entry* outer = dispatching_;
+    bool outerDone = dispatchingDone_;
+    dispatching_ = entry;
+    dispatchingDone_ = false;
+    getdns_return_t r = ctx_->Issue(entry->kind, entry->name.c_str(), entry->type, address, extensions,
+                                    entry, &issuedId, GNScheduler::Callback);
+    bool done = dispatchingDone_;
+    dispatching_ = outer;
+    dispatchingDone_ = outerDone;
+    if (r != GETDNS_RETURN_GOOD) {
+        stats.running--;
+        running_--;
+        entry->running = false;
+    } else if (!done) {
+        entry->issuedId = issuedId;
+    }
+    return r;
+}
+
+// Dispatch queued lookups while there is room, highest class first
+void GNScheduler::Pump() {
+    if (pumping_) {
+        repump_ = true;
+        return;
+    }
+    pumping_ = true;
+    do {
+        repump_ = false;
+        Refill();
+        for (int p = 0; p < NumPriorities && !stopped_; ++p) {
+            if (limit_ != 0 && running_ >= limit_) {
+                break;
+            }
+            while (!queues_[p].empty() && HasRoom((Priority) p) && !stopped_) {
+                Entry* entry = queues_[p].front();
+                queues_[p].pop_front();
+
+                getdns_dict* args = entry->args;
+                getdns_dict* address = NULL;
+                getdns_dict* extensions = NULL;
+                getdns_dict_get_dict(args, "address", &address);
+                getdns_dict_get_dict(args, "extensions", &extensions);
+                entry->args = NULL;
+
+                getdns_return_t r = Dispatch(entry, address, extensions);
+                getdns_dict_destroy(args);
+                if (r != GETDNS_RETURN_GOOD) {
+                    Finish(entry);
+                    entry->callback(ctx_->context_, GETDNS_CALLBACK_ERROR, NULL, entry->userArg, entry->id);
+                    delete entry;
+                }
+            }
+        }
+    } while (repump_);
+    pumping_ = false;
+    for (int p = 0; p < NumPriorities && !stopped_; ++p) {
+        if (!queues_[p].empty()) {
+            ArmRefill();
+            break;
+        }
+    }
+}
+
+void GNScheduler::Finish(Entry* entry) {
+    entries_.erase(entry->id);
+    if (entry->running) {
+        classes_[entry->priority].running--;
+        running_--;
+        entry->running = false;
+    }
+}
+
+void GNScheduler::Callback(getdns_context* context,
+                           getdns_callback_type_t cbType,
+                           getdns_dict* response,
+                           void* userArg,
+                           getdns_transaction_t transId) {
+    Entry* entry = static_cast<Entry*>(userArg);
+    GNScheduler* scheduler = entry->scheduler;
+    if (entry == scheduler->dispatching_) {
+        // called back before getdns returned the transaction id
+        scheduler->dispatchingDone_ = true;
+    }
+    scheduler->Finish(entry);
+    entry->callback(context, cbType, response, entry->userArg, entry->id);
+    delete entry;
+    scheduler->Pump();
+}
+
+getdns_return_t GNScheduler::Cancel(getdns_transaction_t transId) {
+    std::unordered_map<getdns_transaction_t, Entry*>::iterator it = entries_.find(transId);
+    if (it == entries_.end()) {
+        return GETDNS_RETURN_UNKNOWN_TRANSACTION;
+    }
+    Entry* entry = it->second;
+    if (entry->running) {
+        return ctx_->CancelIssued(entry->issuedId);
+    }
+    queues_[entry->priority].erase(entry->position);
+    Finish(entry);
+    getdns_dict_destroy(entry->args);
+    entry->callback(ctx_->context_, GETDNS_CALLBACK_CANCEL, NULL, entry->userArg, entry->id);
+    delete entry;
+    return GETDNS_RETURN_GOOD;
+}
+
+void GNScheduler::Stop() {
+    stopped_ = true;
+    uv_timer_stop(&timer_);
+    for (int p = 0; p < NumPriorities; ++p) {
+        while (!queues_[p].empty()) {
+            Cancel(queues_[p].front()->id);
+        }
+    }
+}
+
+Local<Object> GNScheduler::Limits() {
+    Local<Object> limits = Nan::New<Object>();
+    for (int p = 0; p < NumPriorities; ++p) {
+        Nan::Set(limits, Nan::New<String>(PRIORITY_NAMES[p]).ToLocalChecked(), Nan::New<Uint32>(classes_[p].limit));
+    }
+    Nan::Set(limits, Nan::New<String>("total").ToLocalChecked(), Nan::New<Uint32>(limit_));
+    return limits;
+}
+
+Local<Value> GNScheduler::RateLimit() {
+    if (rate_ == 0) {
+        return Nan::Undefined();
+    }
+    Local<Object> rateLimit = Nan::New<Object>();
+    Nan::Set(rateLimit, Nan::New<String>("rate").ToLocalChecked(), Nan::New<Number>(rate_));
+    Nan::Set(rateLimit, Nan::New<String>("burst").ToLocalChecked(), Nan::New<Number>(burst_));
+    Nan::Set(rateLimit, Nan::New<String>("queue").ToLocalChecked(), Nan::New<Boolean>(!failWhenLimited_));
+    return rateLimit;
+}
+
+Local<Object> GNScheduler::Stats() {
+    Local<Object> result = Nan::New<Object>();
+    for (int p = 0; p < NumPriorities; ++p) {
+        const ClassStats& stats = classes_[p];
+        Local<Object> entry = Nan::New<Object>();
+        Nan::Set(entry, Nan::New<String>("limit").ToLocalChecked(), Nan::New<Uint32>(stats.limit));
+        Nan::Set(entry, Nan::New<String>("running").ToLocalChecked(), Nan::New<Uint32>(stats.running));
+        Nan::Set(entry, Nan::New<String>("queued").ToLocalChecked(), Nan::New<Number>((double) queues_[p].size()));
+        Nan::Set(entry, Nan::New<String>("dispatched").ToLocalChecked(), Nan::New<Number>((double) stats.dispatched));
+        double waitAverage = stats.dispatched ? (double) stats.waitTotal / stats.dispatched / 1e6 : 0;
+        Nan::Set(entry, Nan::New<String>("waitAverage").ToLocalChecked(), Nan::New<Number>(waitAverage));
+        Nan::Set(entry, Nan::New<String>("waitMax").ToLocalChecked(), Nan::New<Number>((double) stats.waitMax / 1e6));
+        Nan::Set(result, Nan::New<String>(PRIORITY_NAMES[p]).ToLocalChecked(), entry);
+    }
+    Nan::Set(result, Nan::New<String>("limit").ToLocalChecked(), Nan::New<Uint32>(limit_));
+    Nan::Set(result, Nan::New<String>("running").ToLocalChecked(), Nan::New<Uint32>(running_));
+    if (rate_ != 0) {
+        Refill();
+        Local<Object> rateLimit = Nan::New<Object>();
+        Nan::Set(rateLimit, Nan::New<String>("rate").ToLocalChecked(), Nan::New<Number>(rate_));
+        Nan::Set(rateLimit, Nan::New<String>("burst").ToLocalChecked(), Nan::New<Number>(burst_));
+        Nan::Set(rateLimit, Nan::New<String>("tokens").ToLocalChecked(), Nan::New<Number>(tokens_));
+        Nan::Set(rateLimit, Nan::New<String>("limited").ToLocalChecked(), Nan::New<Number>((double) limited_));
+        Nan::Set(rateLimit, Nan::New<String>("rejected").ToLocalChecked(), Nan::New<Number>((double) rejected_));
+        Nan::Set(result, Nan::New<String>("rateLimit").ToLocalChecked(), rateLimit);
+    }
+    return result;
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_SCHEDULER_H_
+#define _GN_SCHEDULER_H_
+
+#include <nan.h>
+#include <getdns/getdns.h>
+#include <uv.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "GNEngine.h"
+
+class GNContext;
+
+// Admission control in front of a context. Lookups are submitted with a
+// priority class, each class has its own limit of lookups in flight, and
+// there is an overall limit. Lookups over a limit wait in a queue per
+// class, and freed slots go to the waiting lookups of the highest class
+// first, so interactive lookups don't wait behind bulk work.
+//
+// A token bucket can limit the rate at which lookups are dispatched too.
+// Lookups over the rate wait in the queues as well, or fail right away
+// with RATE_LIMITED.
+//
+// Transaction ids are assigned by the scheduler, as lookups only get a
+// getdns id once they are dispatched.
+class GNScheduler {
+public:
+    typedef enum Priority {
+        Interactive = 0,
+        Normal,
+        Bulk,
+        NumPriorities
+    } Priority;
+
+    // Returned for lookups over the rate limit, as RETURN_RATE_LIMITED
+    static const int RATE_LIMITED = 1000;
+
+    // Read the limits of the scheduler and rate_limit creation options,
+    // either may be undefined. NULL, with a TypeError thrown, for
+    // invalid limits
+    static GNScheduler* Create(GNContext* ctx, v8::Local<v8::Value> options, v8::Local<v8::Value> rateLimit);
+
+    // Read a priority name, false for unknown names
+    static bool ParsePriority(v8::Local<v8::Value> value, Priority* priority);
+
+    // Issue a lookup now, or queue it when over a limit. The extensions
+    // and address of queued lookups are copied. Failures to issue a
+    // queued lookup are reported as GETDNS_CALLBACK_ERROR.
+    getdns_return_t Submit(GNEngine::QueryKind kind,
+                           const char* name,
+                           uint16_t type,
+                           getdns_dict* address,
+                           getdns_dict* extensions,
+                           void* userArg,
+                           getdns_transaction_t* transId,
+                           getdns_callback_t callback,
+                           Priority priority);
+
+    // Cancel a lookup like getdns_cancel_callback. Queued lookups call
+    // back right away with GETDNS_CALLBACK_CANCEL
+    getdns_return_t Cancel(getdns_transaction_t transId);
+
+    // Cancel the queued lookups and stop dispatching, before the
+    // context is destroyed
+    void Stop();
+
+    // Stop the rate limit timer and free once it is closed
+    void Close();
+
+    // The limits, in the format of the creation options
+    v8::Local<v8::Object> Limits();
+    v8::Local<v8::Value> RateLimit();
+
+    // Per class { limit, running, queued, dispatched, waitAverage,
+    // waitMax }, times in ms, and the overall limit and running count.
+    // With a rate limit, rateLimit is { rate, burst, tokens, limited,
+    // rejected }
+    v8::Local<v8::Object> Stats();
+
+private:
+    typedef struct Entry {
+        GNScheduler* scheduler;
+        GNEngine::QueryKind kind;
+        Priority priority;
+        std::string name;
+        uint16_t type;
+        // holds copies of the "address" and "extensions" dicts while queued
+        getdns_dict* args;
+        void* userArg;
+        getdns_callback_t callback;
+        getdns_transaction_t id;
+        // getdns id once dispatched
+        getdns_transaction_t issuedId;
+        bool running;
+        uint64_t queuedAt;
+        std::list<Entry*>::iterator position;
+    } Entry;
+
+    typedef struct ClassStats {
+        uint32_t limit;
+        uint32_t running;
+        uint64_t dispatched;
+        uint64_t waitTotal;
+        uint64_t waitMax;
+    } ClassStats;
+
+    explicit GNScheduler(GNContext* ctx);
+    ~GNScheduler();
+
+    bool HasRoom(Priority priority) const;
+    void Refill();
+    void ArmRefill();
+    getdns_return_t Dispatch(Entry* entry, getdns_dict* address, getdns_dict* extensions);
+    void Pump();
+    void Finish(Entry* entry);
+
+    static void Callback(getdns_context* context,
+                         getdns_callback_type_t cbType,
+                         getdns_dict* response,
+                         void* userArg,
+                         getdns_transaction_t transId);
+    static void OnRefill(uv_timer_t* handle);
+    static void OnClosed(uv_handle_t* handle);
+
+    GNContext* ctx_;
+    ClassStats classes_[NumPriorities];
+    std::list<Entry*> queues_[NumPriorities];
+    uint32_t limit_;
+    uint32_t running_;
+    std::unordered_map<getdns_transaction_t, Entry*> entries_;
+    getdns_transaction_t nextId_;
+    // the entry being dispatched, and whether it called back meanwhile
+    Entry* dispatching_;
+    bool dispatchingDone_;
+    bool pumping_;
+    bool repump_;
+    bool stopped_;
+
+    // token bucket, rate_ is 0 without a rate limit
+    double rate_;
+    double burst_;
+    double tokens_;
+    uint64_t refilledAt_;
+    bool failWhenLimited_;
+    uint64_t limited_;
+    uint64_t rejected_;
+    uv_timer_t timer_;
+};
+
+#endif
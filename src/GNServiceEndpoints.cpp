@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNServiceEndpoints.h"
+#include "GNContext.h"
+#include "GNUtil.h"
+
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+using namespace v8;
+
+// Per target user arg for the address lookups
+typedef struct TargetQuery {
+    GNServiceEndpoints* endpoints;
+    size_t index;
+} TargetQuery;
+
+// Convert an rr owner or rdata name to a string, empty on failure
+static std::string dnameToString(getdns_bindata* dname) {
+    char* fqdn = NULL;
+    std::string result;
+    if (dname && getdns_convert_dns_name_to_fqdn(dname, &fqdn) == GETDNS_RETURN_GOOD) {
+        result = fqdn;
+        free(fqdn);
+    }
+    return result;
+}
+
+static bool sameName(const std::string& a, const std::string& b) {
+    return a.size() == b.size() && strcasecmp(a.c_str(), b.c_str()) == 0;
+}
+
+GNServiceEndpoints::GNServiceEndpoints(GNContext* ctx, Nan::Callback* callback) :
+    ctx_(ctx), callback_(callback), extension_(NULL), pending_(0) { }
+
+GNServiceEndpoints::~GNServiceEndpoints() {
+    if (extension_) {
+        getdns_dict_destroy(extension_);
+    }
+    delete callback_;
+}
+
+// Collect the SRV answers, and any target addresses the server already
+// put in the additional section.
+void GNServiceEndpoints::ParseSrv(getdns_dict* response) {
+    GNUtil::forEachRR(response, "answer", [this](getdns_dict* rr, uint32_t type) {
+        getdns_dict* rdata = NULL;
+        getdns_bindata* target = NULL;
+        uint32_t priority = 0, weight = 0, port = 0, ttl = 0;
+        if (type != GETDNS_RRTYPE_SRV ||
+            getdns_dict_get_dict(rr, "rdata", &rdata) != GETDNS_RETURN_GOOD ||
+            getdns_dict_get_bindata(rdata, "target", &target) != GETDNS_RETURN_GOOD) {
+            return;
+        }
+        getdns_dict_get_int(rdata, "priority", &priority);
+        getdns_dict_get_int(rdata, "weight", &weight);
+        getdns_dict_get_int(rdata, "port", &port);
+        getdns_dict_get_int(rr, "ttl", &ttl);
+        Target srv;
+        srv.name = dnameToString(target);
+        // a lone "." means the service is decidedly not available
+        if (srv.name.empty() || srv.name == ".") {
+            return;
+        }
+        srv.priority = (uint16_t) priority;
+        srv.weight = (uint16_t) weight;
+        srv.port = (uint16_t) port;
+        srv.ttl = ttl;
+        targets_.push_back(srv);
+    });
+    GNUtil::forEachRR(response, "additional", [this](getdns_dict* rr, uint32_t type) {
+        getdns_bindata* owner = NULL;
+        uint32_t ttl = 0;
+        if (getdns_dict_get_bindata(rr, "name", &owner) != GETDNS_RETURN_GOOD) {
+            return;
+        }
+        char* addrStr = GNUtil::rrAddressString(rr, type);
+        if (!addrStr) {
+            return;
+        }
+        getdns_dict_get_int(rr, "ttl", &ttl);
+        std::string ownerName = dnameToString(owner);
+        for (size_t i = 0; i < targets_.size(); ++i) {
+            if (sameName(targets_[i].name, ownerName)) {
+                Address address;
+                address.address = addrStr;
+                address.family = type == GETDNS_RRTYPE_A ? 4 : 6;
+                address.ttl = std::min(ttl, targets_[i].ttl);
+                targets_[i].addresses.push_back(address);
+            }
+        }
+        free(addrStr);
+    });
+}
+
+// Look up the addresses of all targets that had none in the additional section
+void GNServiceEndpoints::ResolveTargets() {
+    // hold one count while issuing, in case lookups finish synchronously
+    pending_ = 1;
+    for (size_t i = 0; i < targets_.size(); ++i) {
+        if (!targets_[i].addresses.empty() || !ctx_->context_) {
+            continue;
+        }
+        TargetQuery* query = new TargetQuery();
+        query->endpoints = this;
+        query->index = i;
+        pending_++;
+        getdns_transaction_t transId;
+        getdns_return_t r = ctx_->Address(targets_[i].name.c_str(), extension_,
+                                          query, &transId, GNServiceEndpoints::AddressCallback);
+        if (r != GETDNS_RETURN_GOOD) {
+            // the target just ends up without endpoints
+            pending_--;
+            delete query;
+        }
+    }
+    if (--pending_ == 0) {
+        Finish(0);
+    }
+}
+
+// RFC 2782 ordering: by priority, then a weighted random pick within each priority
+void GNServiceEndpoints::OrderTargets() {
+    static std::mt19937 rng(std::random_device{}());
+    std::stable_sort(targets_.begin(), targets_.end(), [](const Target& a, const Target& b) {
+        return a.priority < b.priority;
+    });
+    size_t start = 0;
+    while (start < targets_.size()) {
+        size_t end = start;
+        while (end < targets_.size() && targets_[end].priority == targets_[start].priority) {
+            end++;
+        }
+        // zero weights go first, so they only win when nothing else is left
+        std::stable_sort(targets_.begin() + start, targets_.begin() + end, [](const Target& a, const Target& b) {
+            return a.weight == 0 && b.weight != 0;
+        });
+        for (size_t pos = start; pos < end; ++pos) {
+            uint32_t total = 0;
+            for (size_t i = pos; i < end; ++i) {
+                total += targets_[i].weight;
+            }
+            uint32_t pick = std::uniform_int_distribution<uint32_t>(0, total)(rng);
+            uint32_t running = 0;
+            size_t chosen = pos;
+            for (size_t i = pos; i < end; ++i) {
+                running += targets_[i].weight;
+                if (running >= pick) {
+                    chosen = i;
+                    break;
+                }
+            }
+            std::swap(targets_[pos], targets_[chosen]);
+        }
+        start = end;
+    }
+}
+
+void GNServiceEndpoints::Finish(int errCode) {
+    Nan::HandleScope scope;
+    Local<Value> argv[2];
+    if (errCode) {
+        argv[0] = GNUtil::makeErrorObj("Lookup failed.", errCode);
+        argv[1] = Nan::Null();
+    } else {
+        OrderTargets();
+        Local<Array> list = Nan::New<Array>();
+        uint32_t idx = 0;
+        for (size_t i = 0; i < targets_.size(); ++i) {
+            const Target& target = targets_[i];
+            for (size_t j = 0; j < target.addresses.size(); ++j) {
+                const Address& address = target.addresses[j];
+                Local<Object> endpoint = Nan::New<Object>();
+                Nan::Set(endpoint, Nan::New<String>("name").ToLocalChecked(), Nan::New<String>(target.name).ToLocalChecked());
+                Nan::Set(endpoint, Nan::New<String>("port").ToLocalChecked(), Nan::New<Integer>(target.port));
+                Nan::Set(endpoint, Nan::New<String>("priority").ToLocalChecked(), Nan::New<Integer>(target.priority));
+                Nan::Set(endpoint, Nan::New<String>("weight").ToLocalChecked(), Nan::New<Integer>(target.weight));
+                Nan::Set(endpoint, Nan::New<String>("address").ToLocalChecked(), Nan::New<String>(address.address).ToLocalChecked());
+                Nan::Set(endpoint, Nan::New<String>("family").ToLocalChecked(), Nan::New<Integer>(address.family));
+                Nan::Set(endpoint, Nan::New<String>("ttl").ToLocalChecked(), Nan::New<Number>(address.ttl));
+                Nan::Set(list, idx++, endpoint);
+            }
+        }
+        argv[0] = Nan::Null();
+        argv[1] = list;
+    }
+
+    Nan::TryCatch try_catch;
+    callback_->Call(Nan::GetCurrentContext()->Global(), 2, argv);
+    if (try_catch.HasCaught())
+        Nan::FatalException(try_catch);
+
+    ctx_->Unref();
+    delete this;
+}
+
+void GNServiceEndpoints::SrvCallback(getdns_context* context,
+                                     getdns_callback_type_t cbType,
+                                     getdns_dict* response,
+                                     void* userArg,
+                                     getdns_transaction_t transId) {
+    GNServiceEndpoints* endpoints = static_cast<GNServiceEndpoints*>(userArg);
+    if (cbType != GETDNS_CALLBACK_COMPLETE) {
+        if (response) {
+            getdns_dict_destroy(response);
+        }
+        endpoints->Finish(cbType);
+        return;
+    }
+    endpoints->ParseSrv(response);
+    getdns_dict_destroy(response);
+    endpoints->ResolveTargets();
+}
+
+void GNServiceEndpoints::AddressCallback(getdns_context* context,
+                                         getdns_callback_type_t cbType,
+                                         getdns_dict* response,
+                                         void* userArg,
+                                         getdns_transaction_t transId) {
+    TargetQuery* query = static_cast<TargetQuery*>(userArg);
+    GNServiceEndpoints* endpoints = query->endpoints;
+    Target& target = endpoints->targets_[query->index];
+    delete query;
+    if (cbType == GETDNS_CALLBACK_COMPLETE) {
+        GNUtil::forEachRR(response, "answer", [&target](getdns_dict* rr, uint32_t type) {
+            uint32_t ttl = 0;
+            char* addrStr = GNUtil::rrAddressString(rr, type);
+            getdns_dict_get_int(rr, "ttl", &ttl);
+            if (addrStr) {
+                Address address;
+                address.address = addrStr;
+                address.family = type == GETDNS_RRTYPE_A ? 4 : 6;
+                address.ttl = std::min(ttl, target.ttl);
+                target.addresses.push_back(address);
+                free(addrStr);
+            }
+        });
+    }
+    if (response) {
+        getdns_dict_destroy(response);
+    }
+    if (--endpoints->pending_ == 0) {
+        endpoints->Finish(0);
+    }
+}
+
+// Handle ctx.getServiceEndpoints(name, [extensions], callback)
+NAN_METHOD(GNServiceEndpoints::Start) {
+    if (info.Length() < 2) {
+        return Nan::ThrowTypeError(Nan::New<String>("At least 2 arguments are required.").ToLocalChecked());
+    }
+    // last arg must be a callback
+    Local<Value> last = info[info.Length() - 1];
+    if (!last->IsFunction()) {
+        return Nan::ThrowTypeError(Nan::New<String>("Final argument must be a function.").ToLocalChecked());
+    }
+    Local<Function> localCb = Local<Function>::Cast(last);
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        Local<Value> err = GNUtil::makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        return;
+    }
+    // take first arg and make it a string
+    Nan::Utf8String name(info[0]);
+
+    GNServiceEndpoints* endpoints = new GNServiceEndpoints(ctx, new Nan::Callback(localCb));
+    if (info.Length() > 2 && info[1]->IsObject()) {
+        endpoints->extension_ = GNUtil::convertToDict(Nan::To<v8::Object>(info[1]).ToLocalChecked());
+    }
+    ctx->Ref();
+
+    getdns_transaction_t transId;
+    getdns_return_t r = ctx->General(*name, GETDNS_RRTYPE_SRV,
+                                     endpoints->extension_, endpoints, &transId,
+                                     GNServiceEndpoints::SrvCallback);
+    if (r != GETDNS_RETURN_GOOD) {
+        ctx->Unref();
+        delete endpoints;
+        Local<Value> err = GNUtil::makeErrorObj("Error issuing query", r);
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        return;
+    }
+    // done. return as buffer
+    info.GetReturnValue().Set(GNUtil::convertToBuffer(&transId, 8));
+}
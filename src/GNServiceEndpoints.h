@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_SERVICE_ENDPOINTS_H_
+#define _GN_SERVICE_ENDPOINTS_H_
+
+#include <node.h>
+#include <nan.h>
+#include <getdns/getdns.h>
+
+#include <string>
+#include <vector>
+
+class GNContext;
+
+// Resolves SRV records and chases the targets' addresses into a
+// priority and weight ordered list of endpoints, with one callback.
+class GNServiceEndpoints {
+public:
+    // ctx.getServiceEndpoints(name, [extensions], callback)
+    static NAN_METHOD(Start);
+
+private:
+    typedef struct Address {
+        std::string address;
+        int family;
+        uint32_t ttl;
+    } Address;
+
+    typedef struct Target {
+        std::string name;
+        uint16_t priority;
+        uint16_t weight;
+        uint16_t port;
+        uint32_t ttl;
+        std::vector<Address> addresses;
+    } Target;
+
+    GNServiceEndpoints(GNContext* ctx, Nan::Callback* callback);
+    ~GNServiceEndpoints();
+
+    void ParseSrv(getdns_dict* response);
+    void ResolveTargets();
+    void OrderTargets();
+    void Finish(int errCode);
+
+    static void SrvCallback(getdns_context* context,
+                            getdns_callback_type_t cbType,
+                            getdns_dict* response,
+                            void* userArg,
+                            getdns_transaction_t transId);
+    static void AddressCallback(getdns_context* context,
+                                getdns_callback_type_t cbType,
+                                getdns_dict* response,
+                                void* userArg,
+                                getdns_transaction_t transId);
+
+    GNContext* ctx_;
+    Nan::Callback* callback_;
+    getdns_dict* extension_;
+    std::vector<Target> targets_;
+    size_t pending_;
+};
+
+#endif
@@ -213,6 +213,13 @@ getdns_extension_set_libuv_loop(getdns_context *context, uv_loop_t *loop)
  */
 bool
 GNUtil::attachContextToNode(struct getdns_context* context)
+{
+    // TODO: use the loop from the current Environment
+    return GNUtil::attachContextToLoop(context, uv_default_loop());
+}
+
+bool
+GNUtil::attachContextToLoop(struct getdns_context* context, uv_loop_t* uv_loop)
 {
     if (!context) { return false; }
     /* TODO: cleanup current extension base */
@@ -220,8 +227,6 @@ GNUtil::attachContextToNode(struct getdns_context* context)
     if (r != GETDNS_RETURN_GOOD) {
         return false;
     }
-    // TODO: use the loop from the current Environment
-    uv_loop_t* uv_loop = uv_default_loop();
     r = getdns_extension_set_libuv_loop(context, uv_loop);
     return r == GETDNS_RETURN_GOOD;
 }
@@ -446,6 +451,31 @@ bool GNUtil::isDictionaryObject(Local<Value> obj) {
              obj->IsFunction() || obj->IsArray());
 }
 
+char* GNUtil::rrAddressString(getdns_dict* rr, uint32_t type) {
+    getdns_dict* rdata = NULL;
+    getdns_bindata* addr = NULL;
+    if ((type != GETDNS_RRTYPE_A && type != GETDNS_RRTYPE_AAAA) ||
+        getdns_dict_get_dict(rr, "rdata", &rdata) != GETDNS_RETURN_GOOD ||
+        getdns_dict_get_bindata(rdata, type == GETDNS_RRTYPE_A ? "ipv4_address" : "ipv6_address", &addr) != GETDNS_RETURN_GOOD) {
+        return NULL;
+    }
+    return getdns_display_ip_address(addr);
+}
+
+// Helper to create an error object for lookup callbacks
+Local<Value> GNUtil::makeErrorObj(const char* msg, int code) {
+    Local<Object> obj = Nan::New<Object>();
+    Nan::Set(obj, Nan::New<String>("msg").ToLocalChecked(), Nan::New<String>(msg).ToLocalChecked());
+    Nan::Set(obj, Nan::New<String>("code").ToLocalChecked(), Nan::New<Integer>(code));
+    return obj;
+}
+
+Local<Value> GNUtil::makeTypeErrorWithCode(const char* msg, int code) {
+    Local<Object> error = Nan::TypeError(Nan::New<String>(msg).ToLocalChecked()).As<Object>();
+    Nan::Set(error, Nan::New<String>("code").ToLocalChecked(), Nan::New<Integer>(code));
+    return error;
+}
+
 static GetdnsType getGetdnsType(Local<Value> value) {
     if (value->IsNumber() || value->IsNumberObject()) {
         return IntType;
@@ -29,10 +29,8 @@
 #define _GN_UTIL_H_
 
 #include <node.h>
-
-struct getdns_dict;
-struct getdns_list;
-struct getdns_context;
+#include <getdns/getdns.h>
+#include <uv.h>
 
 using namespace v8;
 
@@ -42,6 +40,8 @@ public:
 
     // Attach a context to node
     static bool attachContextToNode(struct getdns_context* context);
+    // Attach a context to another uv loop
+    static bool attachContextToLoop(struct getdns_context* context, uv_loop_t* loop);
 
     // Conversions from getdns -> JS
     static Local<Value> convertToJSArray(struct getdns_list* list);
@@ -52,9 +52,47 @@ public:
     static struct getdns_list* convertToList(Local<Array> array);
     static struct getdns_dict* convertToDict(Local<Object> obj);
 
+    // Call fn(rr, type) for each rr in one section ("answer",
+    // "authority", "additional") of every reply in a response
+    template <typename Fn>
+    static void forEachRR(struct getdns_dict* response, const char* section, Fn fn) {
+        getdns_list* replies = NULL;
+        size_t numReplies = 0;
+        if (!response || getdns_dict_get_list(response, "replies_tree", &replies) != GETDNS_RETURN_GOOD) {
+            return;
+        }
+        getdns_list_get_length(replies, &numReplies);
+        for (size_t i = 0; i < numReplies; ++i) {
+            getdns_dict* reply = NULL;
+            getdns_list* rrs = NULL;
+            size_t numRRs = 0;
+            if (getdns_list_get_dict(replies, i, &reply) != GETDNS_RETURN_GOOD ||
+                getdns_dict_get_list(reply, section, &rrs) != GETDNS_RETURN_GOOD) {
+                continue;
+            }
+            getdns_list_get_length(rrs, &numRRs);
+            for (size_t j = 0; j < numRRs; ++j) {
+                getdns_dict* rr = NULL;
+                uint32_t type = 0;
+                if (getdns_list_get_dict(rrs, j, &rr) == GETDNS_RETURN_GOOD &&
+                    getdns_dict_get_int(rr, "type", &type) == GETDNS_RETURN_GOOD) {
+                    fn(rr, type);
+                }
+            }
+        }
+    }
+
+    // The address in an A or AAAA rr as a string, or NULL for other
+    // types. Must be freed by the user
+    static char* rrAddressString(struct getdns_dict* rr, uint32_t type);
+
     // Helper to determine if an object is a plain dict
     static bool isDictionaryObject(Local<Value> obj);
 
+    // Helpers to create error objects for callbacks and exceptions
+    static Local<Value> makeErrorObj(const char* msg, int code);
+    static Local<Value> makeTypeErrorWithCode(const char* msg, int code);
+
 private:
 
     // utility class
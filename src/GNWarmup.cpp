@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNWarmup.h"
+#include "GNContext.h"
+#include "GNUtil.h"
+
+#include <getdns/getdns_extra.h>
+#include <uv.h>
+
+using namespace v8;
+
+GNWarmup::GNWarmup(GNContext* ctx, Nan::Callback* callback) :
+    ctx_(ctx), callback_(callback), queries_(0), succeeded_(0), pending_(0),
+    lastError_(GETDNS_RETURN_GENERIC_ERROR), started_(uv_hrtime()), upstreams_(0) { }
+
+GNWarmup::~GNWarmup() {
+    delete callback_;
+}
+
+// Calls back with { queries, succeeded, failed, elapsed, upstreams,
+// reached }, and an error as well when no query succeeded
+void GNWarmup::Finish() {
+    Nan::HandleScope scope;
+    if (--ctx_->warmups_ == 0 && ctx_->warmupRoundRobin_) {
+        ctx_->warmupRoundRobin_ = false;
+        if (ctx_->context_) {
+            GNEngine::Pause pause(ctx_->engine_);
+            getdns_context_set_round_robin_upstreams(ctx_->context_, 0);
+        }
+    }
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New<String>("queries").ToLocalChecked(), Nan::New<Number>((double) queries_));
+    Nan::Set(result, Nan::New<String>("succeeded").ToLocalChecked(), Nan::New<Number>((double) succeeded_));
+    Nan::Set(result, Nan::New<String>("failed").ToLocalChecked(), Nan::New<Number>((double) (queries_ - succeeded_)));
+    Nan::Set(result, Nan::New<String>("elapsed").ToLocalChecked(), Nan::New<Number>((uv_hrtime() - started_) / 1e6));
+    Nan::Set(result, Nan::New<String>("upstreams").ToLocalChecked(), Nan::New<Number>((double) upstreams_));
+    Nan::Set(result, Nan::New<String>("reached").ToLocalChecked(), Nan::New<Number>((double) reached_.size()));
+    Local<Value> argv[2];
+    argv[0] = succeeded_ > 0 ? Nan::Null().As<Value>() : GNUtil::makeErrorObj("Warmup failed.", lastError_);
+    argv[1] = result;
+
+    Nan::TryCatch try_catch;
+    callback_->Call(Nan::GetCurrentContext()->Global(), 2, argv);
+    if (try_catch.HasCaught())
+        Nan::FatalException(try_catch);
+
+    ctx_->Unref();
+    delete this;
+}
+
+void GNWarmup::Callback(getdns_context* context,
+                        getdns_callback_type_t cbType,
+                        getdns_dict* response,
+                        void* userArg,
+                        getdns_transaction_t transId) {
+    GNWarmup* warmup = static_cast<GNWarmup*>(userArg);
+    uint32_t status = cbType;
+    if (cbType == GETDNS_CALLBACK_COMPLETE && response) {
+        getdns_dict_get_int(response, "status", &status);
+    }
+    // any answer, even a negative one, means the connection is up
+    if (cbType == GETDNS_CALLBACK_COMPLETE && status != GETDNS_RESPSTATUS_ALL_TIMEOUT) {
+        warmup->succeeded_++;
+        getdns_list* reports = NULL;
+        getdns_dict* report = NULL;
+        getdns_dict* queryTo = NULL;
+        getdns_bindata* address = NULL;
+        if (warmup->upstreams_ > 0 &&
+            getdns_dict_get_list(response, "call_reporting", &reports) == GETDNS_RETURN_GOOD &&
+            getdns_list_get_dict(reports, 0, &report) == GETDNS_RETURN_GOOD &&
+            getdns_dict_get_dict(report, "query_to", &queryTo) == GETDNS_RETURN_GOOD &&
+            getdns_dict_get_bindata(queryTo, "address_data", &address) == GETDNS_RETURN_GOOD) {
+            uint32_t port = 53;
+            getdns_dict_get_int(queryTo, "port", &port);
+            std::string upstream(reinterpret_cast<const char*>(address->data), address->size);
+            upstream += std::to_string(port);
+            warmup->reached_.insert(upstream);
+        }
+    } else {
+        warmup->lastError_ = status;
+    }
+    if (response) {
+        getdns_dict_destroy(response);
+    }
+    if (--warmup->pending_ == 0) {
+        warmup->Finish();
+    }
+}
+
+// Handle ctx.warmup([options], callback). options.name and options.type
+// are the query to send, the root NS by default. options.queries is the
+// number to send, one per upstream by default.
+NAN_METHOD(GNWarmup::Start) {
+    Local<Value> last = info[info.Length() - 1];
+    if (info.Length() < 1 || !last->IsFunction()) {
+        return Nan::ThrowTypeError(Nan::New<String>("Final argument must be a function.").ToLocalChecked());
+    }
+    Local<Function> localCb = Local<Function>::Cast(last);
+    GNContext* ctx = Nan::ObjectWrap::Unwrap<GNContext>(info.Holder());
+    if (!ctx || !ctx->context_) {
+        Local<Value> err = GNUtil::makeErrorObj("Context is invalid", GETDNS_RETURN_GENERIC_ERROR);
+        Local<Value> cbArgs[] = { err };
+        Nan::MakeCallback(Nan::GetCurrentContext()->Global(), localCb, 1, cbArgs);
+        return;
+    }
+
+    std::string name = ".";
+    uint16_t type = GETDNS_RRTYPE_NS;
+    size_t queries = 0;
+    if (info.Length() > 1 && info[0]->IsObject()) {
+        Local<Object> options = Nan::To<Object>(info[0]).ToLocalChecked();
+        Local<Value> nameVal = Nan::Get(options, Nan::New<String>("name").ToLocalChecked()).ToLocalChecked();
+        Local<Value> typeVal = Nan::Get(options, Nan::New<String>("type").ToLocalChecked()).ToLocalChecked();
+        Local<Value> queriesVal = Nan::Get(options, Nan::New<String>("queries").ToLocalChecked()).ToLocalChecked();
+        if (nameVal->IsString()) {
+            name = *Nan::Utf8String(nameVal);
+        }
+        if (typeVal->IsNumber()) {
+            type = (uint16_t) Nan::To<uint32_t>(typeVal).FromJust();
+        }
+        if (queriesVal->IsNumber()) {
+            queries = Nan::To<uint32_t>(queriesVal).FromJust();
+        }
+    }
+    // recursive contexts have no upstreams, and warm up with one query
+    size_t upstreams = 0;
+    {
+        GNEngine::Pause pause(ctx->engine_);
+        getdns_list* upstreamList = NULL;
+        getdns_resolution_t resolution = GETDNS_RESOLUTION_RECURSING;
+        getdns_context_get_resolution_type(ctx->context_, &resolution);
+        if (resolution == GETDNS_RESOLUTION_STUB) {
+            getdns_context_get_upstream_recursive_servers(ctx->context_, &upstreamList);
+        }
+        if (upstreamList) {
+            getdns_list_get_length(upstreamList, &upstreams);
+            getdns_list_destroy(upstreamList);
+        }
+        // NOTE: other lookups of the context are spread over the
+        // upstreams as well until the last warmup finishes
+        uint8_t roundRobin = 0;
+        if (ctx->warmups_ == 0 && upstreams > 1 &&
+            getdns_context_get_round_robin_upstreams(ctx->context_, &roundRobin) == GETDNS_RETURN_GOOD &&
+            !roundRobin) {
+            getdns_context_set_round_robin_upstreams(ctx->context_, 1);
+            ctx->warmupRoundRobin_ = true;
+        }
+    }
+    if (queries == 0) {
+        queries = upstreams > 0 ? upstreams : 1;
+    }
+
+    getdns_dict* extension = getdns_dict_create();
+    getdns_dict_set_int(extension, "return_call_reporting", GETDNS_EXTENSION_TRUE);
+    GNWarmup* warmup = new GNWarmup(ctx, new Nan::Callback(localCb));
+    warmup->queries_ = queries;
+    warmup->upstreams_ = upstreams;
+    // hold one count while issuing, in case lookups finish synchronously
+    warmup->pending_ = 1;
+    ctx->warmups_++;
+    ctx->Ref();
+    for (size_t i = 0; i < queries; ++i) {
+        getdns_transaction_t transId;
+        warmup->pending_++;
+        getdns_return_t r = ctx->General(name.c_str(), type, extension, warmup, &transId, GNWarmup::Callback);
+        if (r != GETDNS_RETURN_GOOD) {
+            warmup->pending_--;
+            warmup->lastError_ = r;
+        }
+    }
+    getdns_dict_destroy(extension);
+    if (--warmup->pending_ == 0) {
+        warmup->Finish();
+    }
+}
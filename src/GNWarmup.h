@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_WARMUP_H_
+#define _GN_WARMUP_H_
+
+#include <node.h>
+#include <nan.h>
+#include <getdns/getdns.h>
+
+#include <set>
+#include <string>
+
+class GNContext;
+
+// Opens the upstream connections of a context ahead of real traffic by
+// sending a small query per configured upstream, and calls back once all
+// of them are answered or failed. getdns sends every lookup to the first
+// upstream that works, so round robin upstreams are turned on while a
+// warmup of several upstreams runs, and call reporting tells which
+// upstreams were reached.
+class GNWarmup {
+public:
+    // ctx.warmup([options], callback)
+    static NAN_METHOD(Start);
+
+private:
+    GNWarmup(GNContext* ctx, Nan::Callback* callback);
+    ~GNWarmup();
+
+    void Finish();
+
+    static void Callback(getdns_context* context,
+                         getdns_callback_type_t cbType,
+                         getdns_dict* response,
+                         void* userArg,
+                         getdns_transaction_t transId);
+
+    GNContext* ctx_;
+    Nan::Callback* callback_;
+    size_t queries_;
+    size_t succeeded_;
+    size_t pending_;
+    uint32_t lastError_;
+    uint64_t started_;
+    // configured upstreams of a stub context, 0 otherwise
+    size_t upstreams_;
+    // address and port of the upstreams that answered
+    std::set<std::string> reached_;
+};
+
+#endif
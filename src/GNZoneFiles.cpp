@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GNZoneFiles.h"
+#include "GNUtil.h"
+
+#include <getdns/getdns_extra.h>
+#include <stdio.h>
+
+#include <vector>
+
+using namespace v8;
+
+std::map<std::string, getdns_list*> GNZoneFiles::files_;
+
+getdns_return_t GNZoneFiles::Parse(const char* path, getdns_list** records) {
+    FILE* fh = fopen(path, "r");
+    if (!fh) {
+        return GETDNS_RETURN_GENERIC_ERROR;
+    }
+    getdns_list* list = NULL;
+    getdns_return_t r = getdns_fp2rr_list(fh, &list, NULL, 3600);
+    fclose(fh);
+    if (r != GETDNS_RETURN_GOOD) {
+        getdns_list_destroy(list);
+        return GETDNS_RETURN_GENERIC_ERROR;
+    }
+    *records = list;
+    return GETDNS_RETURN_GOOD;
+}
+
+getdns_return_t GNZoneFiles::Get(const char* path, getdns_list** records) {
+    std::map<std::string, getdns_list*>::iterator it = files_.find(path);
+    if (it != files_.end()) {
+        *records = it->second;
+        return GETDNS_RETURN_GOOD;
+    }
+    getdns_list* list = NULL;
+    getdns_return_t r = Parse(path, &list);
+    if (r != GETDNS_RETURN_GOOD) {
+        return r;
+    }
+    files_[path] = list;
+    *records = list;
+    return GETDNS_RETURN_GOOD;
+}
+
+// Read the given file, or all registered ones, again. A file that can't
+// be read keeps its previous records and fails the reload.
+NAN_METHOD(GNZoneFiles::Reload) {
+    std::vector<std::string> paths;
+    if (info.Length() > 0 && !info[0]->IsUndefined()) {
+        if (!info[0]->IsString()) {
+            return Nan::ThrowError(GNUtil::makeTypeErrorWithCode("path", GETDNS_RETURN_INVALID_PARAMETER));
+        }
+        paths.push_back(*Nan::Utf8String(info[0]));
+    } else {
+        for (std::map<std::string, getdns_list*>::iterator it = files_.begin(); it != files_.end(); ++it) {
+            paths.push_back(it->first);
+        }
+    }
+
+    size_t reloaded = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        getdns_list* list = NULL;
+        getdns_return_t r = Parse(paths[i].c_str(), &list);
+        if (r != GETDNS_RETURN_GOOD) {
+            return Nan::ThrowError(GNUtil::makeTypeErrorWithCode(paths[i].c_str(), r));
+        }
+        std::map<std::string, getdns_list*>::iterator it = files_.find(paths[i]);
+        if (it != files_.end()) {
+            getdns_list_destroy(it->second);
+        }
+        files_[paths[i]] = list;
+        ++reloaded;
+    }
+    info.GetReturnValue().Set(Nan::New<Number>((double) reloaded));
+}
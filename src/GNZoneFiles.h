@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GN_ZONE_FILES_H_
+#define _GN_ZONE_FILES_H_
+
+#include <node.h>
+#include <nan.h>
+#include <getdns/getdns.h>
+
+#include <map>
+#include <string>
+
+// Process wide registry of the trust anchor and root hint files used by
+// the trustanchor and dns_root_server options. Each file is parsed once
+// and the record list shared by all contexts configured with it; getdns
+// takes its own copy when it is set. Files are only read again on an
+// explicit getdns.reloadZoneFiles([path]).
+class GNZoneFiles {
+public:
+    // The parsed records of a file, owned by the registry
+    static getdns_return_t Get(const char* path, getdns_list** records);
+
+    // getdns.reloadZoneFiles([path]), returns the number of files read
+    static NAN_METHOD(Reload);
+
+private:
+    static getdns_return_t Parse(const char* path, getdns_list** records);
+
+    static std::map<std::string, getdns_list*> files_;
+};
+
+#endif
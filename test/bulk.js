@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+const withFiles = (input, callback) => {
+    fs.mkdtemp(path.join(os.tmpdir(), "getdns-bulk-"), (err, dir) => {
+        expect(err).to.be(null);
+        const inputPath = path.join(dir, "names.txt");
+        const outputPath = path.join(dir, "results.out");
+        fs.writeFile(inputPath, input, (err) => {
+            expect(err).to.be(null);
+            fs.open(inputPath, "r", (err, inputFd) => {
+                expect(err).to.be(null);
+                fs.open(outputPath, "w", (err, outputFd) => {
+                    expect(err).to.be(null);
+                    callback(inputFd, outputFd, (readOutput) => {
+                        fs.close(inputFd, () => {
+                            fs.close(outputFd, () => {
+                                fs.readFile(outputPath, (err, data) => {
+                                    expect(err).to.be(null);
+                                    readOutput(data);
+                                });
+                            });
+                        });
+                    });
+                });
+            });
+        });
+    });
+};
+
+describe("Bulk lookup", () => {
+    it("Should write one NDJSON line per name", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        withFiles("getdnsapi.net\n# comment\n\nnlnetlabs.nl\r\nverisignlabs.com", (input, output, finish) => {
+            ctx.bulkLookup({
+                input: input,
+                output: output,
+                concurrency: 2,
+            }, (err, stats) => {
+                expect(err).to.be(null);
+                expect(stats.read).to.be(3);
+                expect(stats.answered + stats.failed).to.be(3);
+
+                finish((data) => {
+                    const lines = data.toString().trim()
+                        .split("\n")
+                        .map((line) => JSON.parse(line));
+                    expect(lines).to.have.length(3);
+                    const names = lines.map((line) => line.name).sort();
+                    expect(names).to.eql(["getdnsapi.net", "nlnetlabs.nl", "verisignlabs.com"]);
+                    lines.map((line) => {
+                        expect(line.type).to.be(getdns.RRTYPE_A);
+                        if (line.callback_type === getdns.CALLBACK_COMPLETE) {
+                            expect(line.response.replies_tree).to.be.an(Array);
+                        }
+                    });
+                    shared.destroyContext(ctx, done);
+                });
+            });
+        });
+    });
+
+    it("Should write binary records", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        withFiles("getdnsapi.net\n", (input, output, finish) => {
+            ctx.bulkLookup({
+                input: input,
+                output: output,
+                format: "binary",
+                type: getdns.RRTYPE_AAAA,
+            }, (err, stats) => {
+                expect(err).to.be(null);
+                expect(stats.read).to.be(1);
+
+                finish((data) => {
+                    const nameLength = data.readUInt16BE(0);
+                    expect(data.toString("ascii", 2, 2 + nameLength)).to.be("getdnsapi.net");
+                    let offset = 2 + nameLength;
+                    expect(data.readUInt16BE(offset)).to.be(getdns.RRTYPE_AAAA);
+                    offset += 2 + 4 + 4;
+                    const wireLength = data.readUInt32BE(offset);
+                    expect(data.length).to.be(offset + 4 + wireLength);
+                    shared.destroyContext(ctx, done);
+                });
+            });
+        });
+    });
+
+    it("Should fail over-long lines without breaking the records", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        withFiles(`${"a".repeat(70000)}\ngetdnsapi.net\n`, (input, output, finish) => {
+            ctx.bulkLookup({
+                input: input,
+                output: output,
+                format: "binary",
+            }, (err, stats) => {
+                expect(err).to.be(null);
+                expect(stats.read).to.be(2);
+                expect(stats.failed).to.be.greaterThan(0);
+
+                finish((data) => {
+                    const names = [];
+                    let offset = 0;
+                    while (offset < data.length) {
+                        const nameLength = data.readUInt16BE(offset);
+                        names.push(data.toString("ascii", offset + 2, offset + 2 + nameLength));
+                        offset += 2 + nameLength + 2 + 4 + 4;
+                        offset += 4 + data.readUInt32BE(offset);
+                    }
+                    expect(offset).to.be(data.length);
+                    expect(names.map((name) => name.length).sort((a, b) => a - b)).to.eql([13, 1024]);
+                    shared.destroyContext(ctx, done);
+                });
+            });
+        });
+    });
+
+    it("Should stop when the context refuses lookups", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            rate_limit: {
+                rate: 1,
+                burst: 1,
+                queue: false,
+            },
+        });
+        const names = [];
+        for (let i = 0; i < 5000; i++) {
+            names.push(`name${i}.getdnsapi.net`);
+        }
+
+        withFiles(names.join("\n"), (input, output, finish) => {
+            ctx.bulkLookup({
+                input: input,
+                output: output,
+            }, (err, stats) => {
+                expect(err.code).to.be(getdns.RETURN_RATE_LIMITED);
+                // the refused names are not written back as failures
+                expect(stats.answered + stats.failed).to.be.below(3);
+                finish(() => shared.destroyContext(ctx, done));
+            });
+        });
+    });
+
+    it("Should finish when the context is destroyed", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            upstream_recursive_servers: [
+                // NOTE: TEST-NET-1 address, which never answers.
+                "192.0.2.1",
+            ],
+            timeout: 10000,
+            threaded: true,
+        });
+        const names = [];
+        for (let i = 0; i < 100; i++) {
+            names.push(`name${i}.getdnsapi.net`);
+        }
+
+        withFiles(names.join("\n"), (input, output, finish) => {
+            ctx.bulkLookup({
+                input: input,
+                output: output,
+                concurrency: 4,
+            }, (err, stats) => {
+                // the cancelled lookups must not start others
+                expect(err).to.be.an("object");
+                expect(stats.answered).to.be(0);
+                expect(ctx.pendingCount()).to.be(0);
+                finish(() => done());
+            });
+            setTimeout(() => ctx.destroy(), 100);
+        });
+    });
+
+    it("Should throw for missing file descriptors", () => {
+        const ctx = getdns.createContext();
+
+        expect(() => {
+            ctx.bulkLookup({}, () => {});
+        }).to.throwException((err) => {
+            expect(err).to.be.an(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+            expect(err.message).to.be("input");
+        });
+
+        expect(ctx.destroy()).to.be.ok();
+    });
+});
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Context configure", () => {
+    it("Should set several options at once", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        ctx.configure({
+            upstream_recursive_servers: [
+                "8.8.8.8",
+            ],
+            timeout: 5000,
+            edns_do_bit: 0,
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err, result) => {
+            expect(err).to.be(null);
+            expect(result.replies_tree).to.be.an(Array);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should accept the same upstreams again", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const options = {
+            upstream_recursive_servers: [
+                "8.8.8.8",
+                [
+                    "8.8.4.4",
+                    53,
+                ],
+            ],
+        };
+        ctx.configure(options);
+        ctx.configure(options);
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err, result) => {
+            expect(err).to.be(null);
+            expect(result.replies_tree).to.be.an(Array);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should reject unknown options before setting any", function(done) {
+        const ctx = getdns.createContext();
+        expect(() => ctx.configure({
+            timeout: 1000,
+            nonexistent: true,
+        })).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+        shared.destroyContext(ctx, done);
+    });
+
+    it("Should reject creation options", function(done) {
+        const ctx = getdns.createContext();
+        expect(() => ctx.configure({
+            threaded: true,
+        })).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+        });
+        shared.destroyContext(ctx, done);
+    });
+
+    it("Should reject invalid values", function(done) {
+        const ctx = getdns.createContext();
+        expect(() => ctx.configure({
+            edns_version: "zero",
+        })).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+        shared.destroyContext(ctx, done);
+    });
+});
@@ -26,6 +26,7 @@
  */
 
 /* global
+AbortController:false,
 describe:false,
 it:false,
 */
@@ -168,5 +169,90 @@ describe("Cancelled queries", () => {
         expect(transId).to.be.ok();
     });
 
-    // TODO: test issuing multiple queries, and canceling some.
+    it("Should cancel some of many queries at once", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        const names = [
+            "getdnsapi.net",
+            "nlnetlabs.nl",
+            "nlnet.nl",
+            "labs.verisigninc.com",
+        ];
+        let remaining = names.length;
+        let cancelCount = 0;
+
+        const transIds = names.map((name) => ctx.address(name, (err) => {
+            if (err && err.code === getdns.CALLBACK_CANCEL) {
+                cancelCount++;
+            }
+
+            remaining--;
+            if (remaining === 0) {
+                expect(cancelCount).to.be(2);
+                shared.destroyContext(ctx, done);
+            }
+        }));
+
+        expect(ctx.cancelMany(transIds.slice(0, 2))).to.be(2);
+        expect(ctx.cancelMany(transIds.slice(0, 2))).to.be(0);
+    });
+
+    it("Should cancel all queries in flight", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        let remaining = 3;
+        const callback = (err, result) => {
+            expect(err.code).to.equal(getdns.CALLBACK_CANCEL);
+            expect(result).to.be(null);
+
+            remaining--;
+            if (remaining === 0) {
+                expect(ctx.cancelAll()).to.be(0);
+                shared.destroyContext(ctx, done);
+            }
+        };
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, callback);
+        ctx.address("nlnetlabs.nl", callback);
+        ctx.resolveRecords("nlnet.nl", getdns.RRTYPE_TXT, {}, callback);
+
+        expect(ctx.cancelAll()).to.be(3);
+    });
+
+    it("Should cancel queries when their signal is aborted", function(done) {
+        if (typeof AbortController === "undefined") {
+            return this.skip();
+        }
+
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const controller = new AbortController();
+
+        const lookups = [
+            ctx.address("getdnsapi.net", { signal: controller.signal }),
+            ctx.general("nlnetlabs.nl", getdns.RRTYPE_AAAA, { signal: controller.signal }),
+        ];
+        controller.abort();
+
+        Promise.all(lookups.map((lookup) => lookup.then(() => null, (err) => err.code)))
+            .then((codes) => {
+                expect(codes).to.eql([
+                    getdns.CALLBACK_CANCEL,
+                    getdns.CALLBACK_CANCEL,
+                ]);
+
+                // NOTE: an aborted signal fails new lookups right away.
+                ctx.address("nlnet.nl", { signal: controller.signal }, (err, result, transId) => {
+                    expect(err.code).to.equal(getdns.CALLBACK_CANCEL);
+                    expect(transId).to.be(null);
+                    shared.destroyContext(ctx, done);
+                });
+            })
+            .catch(done);
+    });
 });
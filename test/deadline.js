@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Deadlines", () => {
+    // NOTE: TEST-NET-1 address, which never answers.
+    const silentUpstream = "192.0.2.1";
+
+    it("Should time out a lookup before the context timeout", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            upstream_recursive_servers: [
+                silentUpstream,
+            ],
+            timeout: 10000,
+        });
+        const started = Date.now();
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, { timeout: 100 }, (err, result) => {
+            expect(err).to.be.an("object");
+            expect(result).to.be(null);
+            expect(err.code).to.be(getdns.CALLBACK_TIMEOUT);
+            expect(Date.now() - started).to.be.below(5000);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should time out helper lookups and resolveRecords", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            upstream_recursive_servers: [
+                silentUpstream,
+            ],
+            timeout: 10000,
+        });
+
+        const shouldNotResolve = () => {
+            throw new Error("Should not resolve");
+        };
+
+        ctx.address("getdnsapi.net", { timeout: 100 })
+            .then(shouldNotResolve, (err) => {
+                expect(err.code).to.be(getdns.CALLBACK_TIMEOUT);
+                return ctx.resolveRecords("getdnsapi.net", getdns.RRTYPE_TXT, { timeout: 100 });
+            })
+            .then(shouldNotResolve, (err) => {
+                expect(err.code).to.be(getdns.CALLBACK_TIMEOUT);
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+
+    it("Should not affect lookups that finish in time", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        ctx.address("getdnsapi.net", { timeout: 10000 }, (err, result) => {
+            expect(err).to.be(null);
+            expect(result).to.be.an("object");
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should still report a cancel as a cancel", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            upstream_recursive_servers: [
+                silentUpstream,
+            ],
+        });
+
+        const transId = ctx.general("getdnsapi.net", getdns.RRTYPE_A, { timeout: 5000 }, (err) => {
+            expect(err.code).to.be(getdns.CALLBACK_CANCEL);
+            shared.destroyContext(ctx, done);
+        });
+        expect(ctx.cancel(transId)).to.be.ok();
+    });
+
+    it("Should fail for a bad timeout", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, { timeout: "soon" }, (err) => {
+            expect(err).to.be.an("object");
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should not keep the deadline of a lookup answered right away", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        // NOTE: answered from the hosts file before the call returns.
+        ctx.address("localhost", { timeout: 50 })
+            .then((result) => {
+                expect(result.just_address_answers).to.be.an(Array);
+                setTimeout(() => {
+                    expect(ctx.pendingCount()).to.be(0);
+                    shared.destroyContext(ctx, done);
+                }, 100);
+            })
+            .catch(done);
+    });
+});
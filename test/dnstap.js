@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const fs = require("fs");
+const net = require("net");
+const os = require("os");
+const path = require("path");
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+// The data frames of a Frame Streams file, after checking its control frames.
+const readFrames = (file) => {
+    const data = fs.readFileSync(file);
+    expect(data.readUInt32BE(0)).to.be(0);
+    // START with the dnstap content type
+    expect(data.readUInt32BE(8)).to.be(2);
+    expect(data.toString("latin1")).to.contain("protobuf:dnstap.Dnstap");
+
+    const frames = [];
+    let offset = 8 + data.readUInt32BE(4);
+    for (;;) {
+        const length = data.readUInt32BE(offset);
+        offset += 4;
+        if (length === 0) {
+            // STOP
+            expect(data.readUInt32BE(offset)).to.be(4);
+            expect(data.readUInt32BE(offset + 4)).to.be(3);
+            expect(offset + 8).to.be(data.length);
+            return frames;
+        }
+        frames.push(data.slice(offset, offset + length));
+        offset += length;
+    }
+};
+
+describe("Dnstap", () => {
+    const tapFile = () => path.join(os.tmpdir(), `getdns-node-test-${process.pid}-${Date.now()}.tap`);
+
+    it("Should log queries and responses to a file", function(done) {
+        const file = tapFile();
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            dnstap: {
+                path: file,
+                identity: "getdns-node-test",
+            },
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err, result) => {
+            expect(err).to.be(null);
+            expect(result.replies_full.length).to.be.greaterThan(0);
+
+            const stats = ctx.dnstapStats();
+            expect(stats.logged).to.be(2 * result.replies_full.length);
+            expect(stats.skipped).to.be(0);
+            expect(stats.dropped).to.be(0);
+            expect(stats.errors).to.be(0);
+
+            expect(ctx.destroy()).to.be.ok();
+            const frames = readFrames(file);
+            fs.unlinkSync(file);
+            expect(frames.length).to.be(stats.logged);
+            expect(frames[0].toString("latin1")).to.contain("getdns-node-test");
+            done();
+        });
+    });
+
+    it("Should sample lookups", function(done) {
+        const file = tapFile();
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            dnstap: {
+                path: file,
+                sample: 2,
+            },
+        });
+
+        let answered = 0;
+        const callback = (err) => {
+            expect(err).to.be(null);
+            if (++answered < 2) {
+                return;
+            }
+            expect(ctx.dnstapStats().skipped).to.be(1);
+            expect(ctx.destroy()).to.be.ok();
+            fs.unlinkSync(file);
+            done();
+        };
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, callback);
+        ctx.general("nlnetlabs.nl", getdns.RRTYPE_A, callback);
+    });
+
+    it("Should share one writer per output", function(done) {
+        const file = tapFile();
+        const pool = new getdns.ContextPool(2, {
+            resolution_type: getdns.RESOLUTION_STUB,
+            dnstap: {
+                path: file,
+            },
+        });
+
+        Promise.all([
+            pool.contexts[0].general("getdnsapi.net", getdns.RRTYPE_A),
+            pool.contexts[1].general("nlnetlabs.nl", getdns.RRTYPE_A),
+        ])
+            .then((results) => {
+                const replies = results.reduce((count, result) => count + result.replies_full.length, 0);
+                expect(pool.contexts[0].dnstapStats().logged).to.be(2 * replies);
+
+                pool.destroy();
+                const frames = readFrames(file);
+                fs.unlinkSync(file);
+                expect(frames.length).to.be(2 * replies);
+                done();
+            })
+            .catch(done);
+    });
+
+    it("Should not hang on a socket reader that doesn't read", function(done) {
+        const socketPath = path.join(os.tmpdir(), `getdns-node-test-${process.pid}-${Date.now()}.sock`);
+        // NOTE: accepts, but never answers the handshake nor reads.
+        const server = net.createServer(() => {});
+        server.listen(socketPath, () => {
+            const ctx = getdns.createContext({
+                dnstap: {
+                    socket: socketPath,
+                },
+            });
+
+            const started = Date.now();
+            expect(ctx.destroy()).to.be.ok();
+            expect(Date.now() - started).to.be.below(8000);
+            server.close(() => done());
+        });
+    });
+
+    it("Should log the lookups of clones to the same writer", function(done) {
+        const file = tapFile();
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            dnstap: {
+                path: file,
+                sample: 3,
+            },
+        });
+        const clone = ctx.clone();
+        const silentClone = ctx.clone({ dnstap: null });
+
+        expect(clone.dnstapStats()).to.be.an("object");
+        expect(silentClone.dnstapStats()).to.be(null);
+        expect(silentClone.destroy()).to.be.ok();
+        expect(clone.destroy()).to.be.ok();
+        expect(ctx.destroy()).to.be.ok();
+        readFrames(file);
+        fs.unlinkSync(file);
+        done();
+    });
+
+    it("Should return null stats without dnstap", function(done) {
+        const ctx = getdns.createContext();
+
+        expect(ctx.dnstapStats()).to.be(null);
+        expect(ctx.destroy()).to.be.ok();
+        done();
+    });
+
+    it("Should reject invalid options", function(done) {
+        expect(() => getdns.createContext({ dnstap: {} })).to.throwException((err) => {
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+        expect(() => getdns.createContext({ dnstap: { path: tapFile(), sample: 0 } })).to.throwException((err) => {
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+        expect(() => getdns.createContext({ dnstap: { path: "/nonexistent/dir/file.tap" } })).to.throwException();
+        done();
+    });
+});
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Drain", () => {
+    it("Should wait for pending lookups and destroy the context", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        let answered = 0;
+
+        const callback = (err, result) => {
+            expect(err).to.be(null);
+            expect(result).to.be.an("object");
+            answered++;
+        };
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, callback);
+        ctx.address("nlnetlabs.nl", callback);
+
+        ctx.drain(10000)
+            .then((result) => {
+                expect(answered).to.be(2);
+                expect(result.pending).to.be(2);
+                expect(result.completed).to.be(2);
+                expect(result.cancelled).to.be(0);
+                expect(result.elapsed).to.be.a("number");
+                expect(ctx.destroy()).to.not.be.ok();
+                done();
+            })
+            .catch(done);
+    });
+
+    it("Should refuse new lookups while draining", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, () => {});
+        const drained = ctx.drain();
+
+        ctx.general("nlnetlabs.nl", getdns.RRTYPE_A, (err) => {
+            expect(err.code).to.be(getdns.RETURN_BAD_CONTEXT);
+            drained.then(() => done(), done);
+        });
+    });
+
+    it("Should cancel lookups pending at the timeout", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            upstream_recursive_servers: [
+                // NOTE: TEST-NET-1 address, which never answers.
+                "192.0.2.1",
+            ],
+            timeout: 10000,
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err) => {
+            expect(err.code).to.be(getdns.CALLBACK_CANCEL);
+        });
+
+        ctx.drain(100)
+            .then((result) => {
+                expect(result.pending).to.be(1);
+                expect(result.completed).to.be(0);
+                expect(result.cancelled).to.be(1);
+                done();
+            })
+            .catch(done);
+    });
+
+    it("Should drain an idle context right away", function(done) {
+        const ctx = getdns.createContext();
+
+        ctx.drain(1000)
+            .then((result) => {
+                expect(result.pending).to.be(0);
+                expect(result.cancelled).to.be(0);
+                done();
+            })
+            .catch(done);
+    });
+});
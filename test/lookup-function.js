@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const net = require("net");
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Lookup function", () => {
+    it("Should work like dns.lookup for a single address", function(done) {
+        const lookup = getdns.createLookup({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        lookup("getdnsapi.net", (err, address, family) => {
+            expect(err).to.be(null);
+            expect(net.isIP(address)).to.be(family);
+            shared.destroyContext(lookup.context, done);
+        });
+    });
+
+    it("Should return all addresses with family and order options", function(done) {
+        const lookup = getdns.createLookup({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        lookup("getdnsapi.net", {
+            all: true,
+            order: "ipv4first",
+        }, (err, addresses) => {
+            expect(err).to.be(null);
+            expect(addresses).to.be.an(Array);
+            expect(addresses).to.not.be.empty();
+            expect(addresses[0].family).to.be(4);
+
+            lookup("getdnsapi.net", {
+                family: 6,
+                all: true,
+            }, (err, addresses6) => {
+                expect(err).to.be(null);
+                addresses6.map((entry) => {
+                    expect(entry.family).to.be(6);
+                    expect(net.isIPv6(entry.address)).to.be.ok();
+                });
+                shared.destroyContext(lookup.context, done);
+            });
+        });
+    });
+
+    it("Should serve repeated lookups from the cache asynchronously", function(done) {
+        const lookup = getdns.createLookup({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        lookup("getdnsapi.net", 4, (err, address) => {
+            expect(err).to.be(null);
+
+            let isSync = true;
+            lookup("getdnsapi.net", 4, (err, cachedAddress) => {
+                expect(isSync).to.be(false);
+                expect(err).to.be(null);
+                expect(cachedAddress).to.be(address);
+                shared.destroyContext(lookup.context, done);
+            });
+            isSync = false;
+        });
+    });
+
+    it("Should pass IP addresses through", function(done) {
+        const lookup = getdns.createLookup();
+
+        lookup("2001:db8::1", (err, address, family) => {
+            expect(err).to.be(null);
+            expect(address).to.be("2001:db8::1");
+            expect(family).to.be(6);
+            shared.destroyContext(lookup.context, done);
+        });
+    });
+
+    it("Should fail with ENOTFOUND for unknown names", function(done) {
+        const lookup = getdns.createLookup({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        lookup("nonexistent.getdnsapi.net", (err) => {
+            expect(err).to.be.an(Error);
+            expect(err.code).to.be("ENOTFOUND");
+            expect(err.hostname).to.be("nonexistent.getdnsapi.net");
+            shared.destroyContext(lookup.context, done);
+        });
+    });
+
+    it("Should be usable as the lookup option of net.connect", function(done) {
+        const lookup = getdns.createLookup({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        const socket = net.connect({
+            host: "getdnsapi.net",
+            port: 80,
+            lookup: lookup,
+        });
+        socket.on("lookup", (err, address) => {
+            expect(err).to.be(null);
+            expect(net.isIP(address)).to.be.ok();
+            socket.destroy();
+            shared.destroyContext(lookup.context, done);
+        });
+    });
+});
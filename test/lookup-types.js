@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const net = require("net");
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Multi-type lookup", () => {
+    it("Should merge results for all types into one callback", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        const types = [getdns.RRTYPE_A, getdns.RRTYPE_AAAA, getdns.RRTYPE_TXT];
+
+        const transIds = ctx.lookupTypes("getdnsapi.net", types, (err, results) => {
+            expect(err).to.be(null);
+            expect(results).to.be.an("object");
+            types.map((type) => {
+                expect(results[type]).to.be.an("object");
+                expect(results[type].replies_tree).to.be.an(Array);
+            });
+            results[getdns.RRTYPE_A].just_address_answers.map((address) => {
+                expect(net.isIPv4(address)).to.be.ok();
+            });
+            shared.destroyContext(ctx, done);
+        });
+
+        expect(transIds).to.be.an(Array);
+        expect(transIds).to.have.length(types.length);
+    });
+
+    it("Should call onEach once per type before the final callback", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        const types = [getdns.RRTYPE_A, getdns.RRTYPE_MX];
+        const seen = [];
+
+        ctx.lookupTypes("getdnsapi.net", types, {}, (err, result, type) => {
+            expect(err).to.be(null);
+            expect(result).to.be.an("object");
+            seen.push(type);
+        }, (err, results) => {
+            expect(err).to.be(null);
+            expect(seen.sort()).to.eql(types.slice().sort());
+            expect(Object.keys(results)).to.have.length(types.length);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should return an error for an empty types list", function(done) {
+        const ctx = getdns.createContext();
+
+        ctx.lookupTypes("getdnsapi.net", [], (err, results) => {
+            expect(err).to.be.an("object");
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+            expect(results).to.be(undefined);
+            shared.destroyContext(ctx, done);
+        });
+    });
+});
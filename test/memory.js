@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Memory accounting", () => {
+    it("Should not count without an allocator", function(done) {
+        const ctx = getdns.createContext();
+        expect(ctx.memoryStats()).to.be(null);
+        shared.destroyContext(ctx, done);
+    });
+
+    it("Should reject unknown allocators", function() {
+        expect(() => getdns.createContext({
+            allocator: "arena",
+        })).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+    });
+
+    ["pool", "malloc"].forEach((allocator) => {
+        it("Should count allocations with the " + allocator + " allocator", function(done) {
+            const ctx = getdns.createContext({
+                allocator: allocator,
+                resolution_type: getdns.RESOLUTION_STUB,
+            });
+            const before = ctx.memoryStats();
+            expect(before.allocator).to.be(allocator);
+            expect(before.allocationCount).to.be.above(0);
+            expect(before.bytesReserved).to.not.be.below(before.bytesAllocated);
+
+            ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err, result) => {
+                expect(err).to.be(null);
+                expect(result.replies_tree).to.be.an(Array);
+
+                const after = ctx.memoryStats();
+                expect(after.allocationCount).to.be.above(before.allocationCount);
+                expect(after.peakBytesAllocated).to.not.be.below(after.bytesAllocated);
+                expect(after.liveAllocations).to.not.be.above(after.allocationCount);
+                shared.destroyContext(ctx, done);
+            });
+        });
+    });
+
+    it("Should count allocations of threaded contexts", function(done) {
+        const ctx = getdns.createContext({
+            allocator: "pool",
+            threaded: true,
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err) => {
+            expect(err).to.be(null);
+            expect(ctx.memoryStats().allocationCount).to.be.above(0);
+            shared.destroyContext(ctx, done);
+        });
+    });
+});
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Pending", () => {
+    it("Should list pending lookups", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            upstream_recursive_servers: [
+                // NOTE: TEST-NET-1 address, which never answers.
+                "192.0.2.1",
+            ],
+            timeout: 10000,
+        });
+
+        const generalId = ctx.general("getdnsapi.net", getdns.RRTYPE_AAAA, () => {});
+        ctx.address("nlnetlabs.nl", () => {});
+        ctx.hostname("8.8.8.8", () => {});
+
+        expect(ctx.pendingCount()).to.be(3);
+
+        const lookups = ctx.pending();
+        expect(lookups).to.be.an("array");
+        expect(lookups.length).to.be(3);
+
+        const general = lookups.find((lookup) => lookup.kind === "general");
+        expect(general.transactionId.equals(generalId)).to.be(true);
+        expect(general.name).to.be("getdnsapi.net");
+        expect(general.type).to.be(getdns.RRTYPE_AAAA);
+        expect(general.age).to.be.a("number");
+        expect(general.upstream).to.be("192.0.2.1");
+
+        const address = lookups.find((lookup) => lookup.kind === "address");
+        expect(address.name).to.be("nlnetlabs.nl");
+        expect(address.type).to.be(null);
+
+        const hostname = lookups.find((lookup) => lookup.kind === "hostname");
+        expect(hostname.name).to.be("8.8.8.8");
+
+        expect(ctx.pending(1).length).to.be(1);
+
+        expect(ctx.destroy()).to.be.ok();
+        done();
+    });
+
+    it("Should forget answered lookups", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err) => {
+            expect(err).to.be(null);
+            expect(ctx.pendingCount()).to.be(0);
+            expect(ctx.pending()).to.eql([]);
+            expect(ctx.destroy()).to.be.ok();
+            done();
+        });
+        expect(ctx.pendingCount()).to.be(1);
+    });
+
+    it("Should report nothing pending for a new context", function(done) {
+        const ctx = getdns.createContext();
+
+        expect(ctx.pendingCount()).to.be(0);
+        expect(ctx.pending()).to.eql([]);
+        expect(ctx.destroy()).to.be.ok();
+        done();
+    });
+});
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Context pool", () => {
+    it("Should create one threaded context per shard", function() {
+        const pool = new getdns.ContextPool(3, {
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        expect(pool.contexts.length).to.be(3);
+        expect(pool.stats().size).to.be(3);
+        expect(pool.destroy()).to.be(true);
+    });
+
+    it("Should reject invalid sizes", function() {
+        expect(() => new getdns.ContextPool(0)).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+    });
+
+    it("Should route names consistently", function() {
+        const pool = new getdns.ContextPool(8, {
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const counts = [0, 0, 0, 0, 0, 0, 0, 0];
+        for (let i = 0; i < 8000; i++) {
+            counts[pool.shardFor("host" + i + ".example.com")]++;
+        }
+        counts.forEach((count) => expect(count).to.be.within(800, 1200));
+        expect(pool.shardFor("GetdnsAPI.net.")).to.be(pool.shardFor("getdnsapi.net"));
+        expect(pool.contextFor("getdnsapi.net")).to.be(pool.contexts[pool.shardFor("getdnsapi.net")]);
+        pool.destroy();
+    });
+
+    it("Should look up records and count them", function(done) {
+        const pool = new getdns.ContextPool(2, {
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        pool.general("getdnsapi.net", getdns.RRTYPE_A, {}, (err, result) => {
+            expect(err).to.be(null);
+            expect(result.replies_tree).to.be.an(Array);
+
+            pool.address("getdnsapi.net").then((response) => {
+                expect(response.just_address_answers).to.be.an(Array);
+
+                const stats = pool.stats();
+                expect(stats.queries).to.be(2);
+                expect(stats.completed).to.be(2);
+                expect(stats.inFlight).to.be(0);
+                expect(stats.errors).to.be(0);
+                expect(stats.shards[pool.shardFor("getdnsapi.net")].queries).to.be(2);
+                pool.destroy();
+                done();
+            }).catch(done);
+        });
+    });
+});
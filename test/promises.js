@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Promises", () => {
+    it("Should return a promise with a transaction id without a callback", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        const lookup = ctx.general("getdnsapi.net", getdns.RRTYPE_A);
+        expect(lookup).to.be.a(Promise);
+        expect(lookup.transactionId).to.be.an(Buffer);
+        expect(lookup.transactionId.length).to.be(8);
+
+        lookup
+            .then((result) => {
+                expect(result).to.be.an("object");
+                expect(result.replies_tree).to.be.an(Array);
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+
+    it("Should return the promise of a lookup answered right away", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        // NOTE: answered from the hosts file before the call returns.
+        const lookup = ctx.address("localhost");
+        expect(lookup).to.be.a(Promise);
+        expect(lookup.transactionId).to.be.an(Buffer);
+
+        lookup
+            .then((result) => {
+                expect(result.just_address_answers).to.be.an(Array);
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+
+    it("Should reject with an Error when cancelled", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        const lookup = ctx.address("getdnsapi.net");
+        expect(ctx.cancel(lookup.transactionId)).to.be.ok();
+
+        lookup
+            .then(() => done(new Error("Should not resolve.")))
+            .catch((err) => {
+                expect(err).to.be.an(Error);
+                expect(err.code).to.be(getdns.CALLBACK_CANCEL);
+                shared.destroyContext(ctx, done);
+            });
+    });
+
+    it("Should iterate over many lookups with bounded concurrency", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const names = [
+            "getdnsapi.net",
+            "nlnetlabs.nl",
+            {
+                name: "getdnsapi.net",
+                type: getdns.RRTYPE_AAAA,
+            },
+        ];
+
+        (async() => {
+            const results = [];
+            for await (const result of ctx.lookupMany(names, {
+                concurrency: 2,
+            })) {
+                results.push(result);
+            }
+
+            return results;
+        })()
+            .then((results) => {
+                expect(results).to.have.length(3);
+                results.map((result) => {
+                    expect(result.error).to.be(undefined);
+                    expect(result.response.replies_tree).to.be.an(Array);
+                });
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+
+    it("Should cancel remaining lookups when leaving the loop early", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const names = [
+            "getdnsapi.net",
+            "nlnetlabs.nl",
+            "verisign.com",
+        ];
+
+        (async() => {
+            for await (const result of ctx.lookupMany(names)) {
+                return result;
+            }
+        })()
+            .then((result) => {
+                expect(result.query).to.be.an("object");
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+
+    it("Should settle more lookups than fit in one batch of records", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const lookups = [];
+        for (let i = 0; i < 150; i++) {
+            if (i % 2 === 0) {
+                lookups.push(ctx.lookup("getdnsapi.net", getdns.RRTYPE_A, {}));
+            } else {
+                lookups.push(new Promise((resolve, reject) => {
+                    ctx.lookup("getdnsapi.net", getdns.RRTYPE_A, {}, (err, result) => (err ? reject(err) : resolve(result)));
+                }));
+            }
+        }
+
+        Promise.all(lookups)
+            .then((results) => {
+                expect(results.length).to.be(150);
+                results.forEach((result) => expect(result.replies_tree).to.be.an(Array));
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+});
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Rate limits", () => {
+    it("Should queue lookups over the rate", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            rate_limit: {
+                rate: 10,
+                burst: 1,
+            },
+        });
+        const started = Date.now();
+        let remaining = 3;
+
+        const callback = (err) => {
+            expect(err).to.be(null);
+            remaining--;
+            if (remaining === 0) {
+                // NOTE: two lookups had to wait 100ms each for a token.
+                expect(Date.now() - started).to.be.above(150);
+
+                const stats = ctx.schedulerStats();
+                expect(stats.rateLimit.rate).to.be(10);
+                expect(stats.rateLimit.burst).to.be(1);
+                expect(stats.rateLimit.limited).to.be(2);
+                expect(stats.rateLimit.rejected).to.be(0);
+                shared.destroyContext(ctx, done);
+            }
+        };
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, callback);
+        ctx.general("nlnetlabs.nl", getdns.RRTYPE_A, callback);
+        ctx.general("nlnet.nl", getdns.RRTYPE_A, callback);
+
+        expect(ctx.schedulerStats().normal.queued).to.be(2);
+    });
+
+    it("Should fail lookups over the rate without queue", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            rate_limit: {
+                rate: 1,
+                queue: false,
+            },
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err) => {
+            expect(err).to.be(null);
+            shared.destroyContext(ctx, done);
+        });
+        ctx.general("nlnetlabs.nl", getdns.RRTYPE_A)
+            .then(() => done(new Error("Should not resolve")), (err) => {
+                expect(err.code).to.be(getdns.RETURN_RATE_LIMITED);
+                expect(ctx.schedulerStats().rateLimit.rejected).to.be(1);
+            });
+    });
+
+    it("Should throw for a bad rate", () => {
+        expect(() => {
+            getdns.createContext({
+                rate_limit: {
+                    rate: 0,
+                },
+            });
+        }).to.throwException((err) => {
+            expect(err).to.be.an(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+    });
+});
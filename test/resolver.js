@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const net = require("net");
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Resolver", () => {
+    it("Should resolve A records as strings", function(done) {
+        const resolver = new getdns.Resolver();
+
+        resolver.resolve4("getdnsapi.net")
+            .then((addresses) => {
+                expect(addresses).to.be.an(Array);
+                expect(addresses).to.not.be.empty();
+                addresses.map((address) => expect(net.isIPv4(address)).to.be.ok());
+                shared.destroyContext(resolver.context, done);
+            })
+            .catch(done);
+    });
+
+    it("Should resolve A records with ttl", function(done) {
+        const resolver = new getdns.Resolver();
+
+        resolver.resolve4("getdnsapi.net", {
+            ttl: true,
+        })
+            .then((records) => {
+                expect(records).to.not.be.empty();
+                expect(net.isIPv4(records[0].address)).to.be.ok();
+                expect(records[0].ttl).to.be.a("number");
+                shared.destroyContext(resolver.context, done);
+            })
+            .catch(done);
+    });
+
+    it("Should resolve MX, TXT and SRV records in node.js shapes", function(done) {
+        const resolver = new getdns.Resolver();
+
+        Promise.all([
+            resolver.resolveMx("getdnsapi.net"),
+            resolver.resolveTxt("getdnsapi.net"),
+            resolver.resolveSrv("_xmpp-server._tcp.jabber.org"),
+        ])
+            .then((results) => {
+                const mx = results[0];
+                const txt = results[1];
+                const srv = results[2];
+
+                expect(mx[0].priority).to.be.a("number");
+                expect(mx[0].exchange).to.be.a("string");
+                expect(mx[0].exchange).to.not.match(/\.$/);
+                expect(txt[0]).to.be.an(Array);
+                expect(txt[0][0]).to.be.a("string");
+                expect(srv[0]).to.only.have.keys("priority", "weight", "port", "name");
+                shared.destroyContext(resolver.context, done);
+            })
+            .catch(done);
+    });
+
+    it("Should reverse IP addresses", function(done) {
+        const resolver = new getdns.Resolver();
+
+        resolver.reverse("8.8.8.8")
+            .then((hostnames) => {
+                expect(hostnames).to.contain("dns.google");
+                shared.destroyContext(resolver.context, done);
+            })
+            .catch(done);
+    });
+
+    it("Should reject with node.js error codes", function(done) {
+        const resolver = new getdns.Resolver();
+
+        resolver.resolve4("nonexistent.getdnsapi.net")
+            .then(() => done(new Error("Should not resolve.")))
+            .catch((err) => {
+                expect(err).to.be.an(Error);
+                expect(err.code).to.be("ENOTFOUND");
+                expect(err.syscall).to.be("queryA");
+                expect(err.hostname).to.be("nonexistent.getdnsapi.net");
+                shared.destroyContext(resolver.context, done);
+            });
+    });
+
+    it("Should set and get servers", function(done) {
+        const resolver = new getdns.Resolver();
+
+        resolver.setServers([
+            "8.8.8.8",
+            "[2001:4860:4860::8888]:53",
+            "8.8.4.4:5353",
+        ]);
+        expect(resolver.getServers()).to.eql([
+            "8.8.8.8",
+            "2001:4860:4860::8888",
+            "8.8.4.4:5353",
+        ]);
+        expect(() => resolver.setServers(["not-an-ip"])).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+        });
+        shared.destroyContext(resolver.context, done);
+    });
+});
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const net = require("net");
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Reverse sweep", () => {
+    it("Should find hostnames in a small block", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        const found = [];
+
+        ctx.reverseSweep(["8.8.8.8/30"], {
+            concurrency: 2,
+            batchSize: 1,
+        }, (pairs) => {
+            expect(pairs).to.be.an(Array);
+            expect(pairs).to.have.length(1);
+            pairs.map((pair) => {
+                expect(net.isIPv4(pair.address)).to.be.ok();
+                expect(pair.hostname).to.be.a("string");
+                found.push(pair.address);
+            });
+        }, (err, stats) => {
+            expect(err).to.be(null);
+            expect(stats.queried).to.be(4);
+            expect(stats.found).to.be(found.length);
+            expect(found).to.contain("8.8.8.8");
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should stop when onBatch returns false", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        let batches = 0;
+
+        ctx.reverseSweep("8.8.8.0/24", {
+            concurrency: 1,
+            batchSize: 1,
+        }, () => {
+            batches++;
+            return false;
+        }, (err, stats) => {
+            expect(err).to.be(null);
+            expect(batches).to.be(1);
+            expect(stats.queried).to.be.below(256);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should stop when the context refuses lookups", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            rate_limit: {
+                rate: 1,
+                burst: 1,
+                queue: false,
+            },
+        });
+
+        // NOTE: all of 10/8 would block the loop if every address was failed in turn.
+        ctx.reverseSweep("10.0.0.0/8", {
+            concurrency: 100,
+        }, () => {}, (err, stats) => {
+            expect(err.code).to.be(getdns.RETURN_RATE_LIMITED);
+            expect(stats.queried).to.be(2);
+            expect(stats.failed).to.be.above(0);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should stop on a draining context", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const drained = ctx.drain();
+
+        ctx.reverseSweep("10.0.0.0/8", () => {}, (err, stats) => {
+            expect(err.code).to.be(getdns.RETURN_BAD_CONTEXT);
+            expect(stats.queried).to.be(1);
+            drained.then(() => done(), done);
+        });
+    });
+
+    it("Should throw for a block that is too large", () => {
+        const ctx = getdns.createContext();
+
+        expect(() => {
+            ctx.reverseSweep("2001:db8::/64", () => {}, () => {});
+        }).to.throwException((err) => {
+            expect(err).to.be.an(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+            expect(err.message).to.be("2001:db8::/64");
+        });
+
+        expect(ctx.destroy()).to.be.ok();
+    });
+});
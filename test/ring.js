@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const ring = require("../ring");
+const shared = require("./shared");
+
+shared.initialize();
+
+// Poll on the main thread, as the context writes results from the event loop.
+const pollResult = function(client, callback) {
+    const result = client.poll();
+    if (result) {
+        return callback(result);
+    }
+
+    setTimeout(() => pollResult(client, callback), 5);
+};
+
+describe("Shared memory rings", () => {
+    it("Should round trip names through the submission ring", function() {
+        const buffer = getdns.createRing({ slots: 4, slotSize: 64 });
+        const client = new ring.RingClient(buffer);
+        expect(client.submit("getdnsapi.net", getdns.RRTYPE_A)).to.be(1);
+        expect(client.submit("getdnsapi.net", getdns.RRTYPE_AAAA)).to.be(2);
+        expect(client.submit("a.example")).to.be(3);
+        expect(client.submit("b.example")).to.be(4);
+        expect(client.submit("c.example")).to.be(-1);
+        expect(client.poll()).to.be(null);
+        expect(client.wait(1)).to.be(false);
+    });
+
+    it("Should reject invalid ring sizes", function() {
+        expect(() => getdns.createRing({ slots: 3 })).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+        });
+        expect(() => getdns.createRing({ slotSize: 60 })).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+        });
+    });
+
+    it("Should reject buffers that are not rings", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        expect(() => ctx.attachRing(new SharedArrayBuffer(1024))).to.throwException((err) => {
+            expect(err).to.be.an(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+        shared.destroyContext(ctx, done);
+    });
+
+    it("Should return addresses through the result ring", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const buffer = getdns.createRing();
+        const client = new ring.RingClient(buffer);
+        ctx.attachRing(buffer);
+
+        const id = client.submit("getdnsapi.net", getdns.RRTYPE_A);
+        pollResult(client, (result) => {
+            expect(result.id).to.be(id);
+            expect(result.status).to.be(getdns.RESPSTATUS_GOOD);
+            expect(result.type).to.be(getdns.RRTYPE_A);
+            expect(result.addresses).to.be.an(Array);
+            expect(result.addresses.length).to.be.above(0);
+            result.addresses.forEach((address) => {
+                expect(address).to.match(/^\d+\.\d+\.\d+\.\d+$/);
+            });
+            expect(ctx.detachRing(buffer)).to.be(true);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should return wire format responses", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const buffer = getdns.createRing({ slots: 8 });
+        const client = new ring.RingClient(buffer);
+        ctx.attachRing(buffer, { format: "wire" });
+
+        client.submit("getdnsapi.net", getdns.RRTYPE_TXT);
+        pollResult(client, (result) => {
+            expect(result.status).to.be(getdns.RESPSTATUS_GOOD);
+            expect(result.wire).to.be.a(Uint8Array);
+            expect(result.wire.length).to.be.above(12);
+            expect(ctx.detachRing(buffer)).to.be(true);
+            expect(ctx.detachRing(buffer)).to.be(false);
+            shared.destroyContext(ctx, done);
+        });
+    });
+});
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Scheduler", () => {
+    it("Should run interactive lookups before queued bulk lookups", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            scheduler: {
+                total: 1,
+            },
+        });
+        const order = [];
+
+        const record = (label) => (err) => {
+            expect(err).to.be(null);
+            order.push(label);
+            if (order.length === 3) {
+                expect(order).to.eql([
+                    "first",
+                    "interactive",
+                    "bulk",
+                ]);
+
+                const stats = ctx.schedulerStats();
+                expect(stats.limit).to.be(1);
+                expect(stats.running).to.be(0);
+                expect(stats.interactive.dispatched).to.be(1);
+                expect(stats.bulk.dispatched).to.be(1);
+                expect(stats.bulk.queued).to.be(0);
+                expect(stats.bulk.waitMax).to.be.above(0);
+                shared.destroyContext(ctx, done);
+            }
+        };
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, record("first"));
+        ctx.general("nlnetlabs.nl", getdns.RRTYPE_A, { priority: "bulk" }, record("bulk"));
+        ctx.address("nlnet.nl", { priority: "interactive" }, record("interactive"));
+
+        const stats = ctx.schedulerStats();
+        expect(stats.normal.running).to.be(1);
+        expect(stats.interactive.queued).to.be(1);
+        expect(stats.bulk.queued).to.be(1);
+    });
+
+    it("Should cancel a queued lookup", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            scheduler: {
+                normal: 1,
+            },
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err) => {
+            expect(err).to.be(null);
+            shared.destroyContext(ctx, done);
+        });
+        const transId = ctx.general("nlnetlabs.nl", getdns.RRTYPE_A, (err, result) => {
+            expect(err.code).to.be(getdns.CALLBACK_CANCEL);
+            expect(result).to.be(null);
+        });
+
+        expect(ctx.cancel(transId)).to.be.ok();
+        expect(ctx.schedulerStats().normal.queued).to.be(0);
+    });
+
+    it("Should fail for an unknown priority", function(done) {
+        const ctx = getdns.createContext({
+            scheduler: {},
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, { priority: "urgent" }, (err) => {
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should issue lookups from the callback of a lookup answered right away", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            scheduler: {
+                total: 4,
+            },
+        });
+        let answered = 0;
+
+        // NOTE: answered from the hosts file while it is dispatched.
+        const lookup = () => {
+            ctx.address("localhost", (err, result) => {
+                expect(err).to.be(null);
+                expect(result.just_address_answers).to.be.an(Array);
+                if (++answered < 3) {
+                    lookup();
+                    return;
+                }
+                setImmediate(() => {
+                    expect(ctx.schedulerStats().normal.running).to.be(0);
+                    expect(ctx.pendingCount()).to.be(0);
+                    shared.destroyContext(ctx, done);
+                });
+            });
+        };
+        lookup();
+    });
+
+    it("Should throw for bad limits", () => {
+        expect(() => {
+            getdns.createContext({
+                scheduler: {
+                    bulk: -1,
+                },
+            });
+        }).to.throwException((err) => {
+            expect(err).to.be.an(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+    });
+
+    it("Should have no stats without a scheduler", () => {
+        const ctx = getdns.createContext();
+
+        expect(ctx.schedulerStats()).to.be(null);
+        expect(ctx.destroy()).to.be.ok();
+    });
+});
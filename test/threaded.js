@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Threaded context", () => {
+    it("Should create a threaded context", function(done) {
+        const ctx = getdns.createContext({
+            threaded: true,
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        expect(ctx).to.be.ok();
+        shared.destroyContext(ctx, done);
+    });
+
+    it("Should look up records off the main thread", function(done) {
+        const ctx = getdns.createContext({
+            threaded: true,
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        const transactionId = ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err, result, callbackTransactionId) => {
+            expect(err).to.be(null);
+            expect(result.replies_tree).to.be.an(Array);
+            expect(result.replies_tree).to.not.be.empty();
+            expect(callbackTransactionId.equals(transactionId)).to.be.ok();
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should deliver many lookups and promises", function(done) {
+        const ctx = getdns.createContext({
+            threaded: true,
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+        const names = [
+            "getdnsapi.net",
+            "nlnetlabs.nl",
+            "verisign.com",
+        ];
+
+        Promise.all(names.map((name) => ctx.address(name)))
+            .then((results) => {
+                results.map((result) => expect(result.just_address_answers).to.not.be.empty());
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+
+    it("Should accept options while running", function(done) {
+        const ctx = getdns.createContext({
+            threaded: true,
+        });
+
+        ctx.resolution_type = getdns.RESOLUTION_STUB;
+        ctx.timeout = 5000;
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err, result) => {
+            expect(err).to.be(null);
+            expect(result.replies_tree).to.be.an(Array);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should cancel lookups asynchronously", function(done) {
+        const ctx = getdns.createContext({
+            threaded: true,
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        let isSync = true;
+        const transactionId = ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err, result) => {
+            expect(isSync).to.be(false);
+            expect(err).to.be.an("object");
+            expect(err.code).to.be(getdns.CALLBACK_CANCEL);
+            expect(result).to.be(null);
+            shared.destroyContext(ctx, done);
+        });
+        expect(ctx.cancel(transactionId)).to.be(true);
+        isSync = false;
+    });
+
+    it("Should cancel pending lookups when destroyed", function(done) {
+        const ctx = getdns.createContext({
+            threaded: true,
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        ctx.general("getdnsapi.net", getdns.RRTYPE_A, (err) => {
+            expect(err).to.be.an("object");
+            expect(err.code).to.be(getdns.CALLBACK_CANCEL);
+            done();
+        });
+        ctx.destroy();
+    });
+});
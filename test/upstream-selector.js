@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Upstream selector", () => {
+    it("Should reject an empty upstream list", function() {
+        expect(() => new getdns.UpstreamSelector([])).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+            expect(err.code).to.be(getdns.RETURN_INVALID_PARAMETER);
+        });
+    });
+
+    it("Should look up records and learn upstream latencies", function(done) {
+        const selector = new getdns.UpstreamSelector([
+            "8.8.8.8",
+            "8.8.4.4",
+        ]);
+
+        selector.general("getdnsapi.net", getdns.RRTYPE_A)
+            .then((result) => {
+                expect(result.replies_tree).to.be.an(Array);
+
+                return selector.address("getdnsapi.net");
+            })
+            .then((result) => {
+                expect(result.just_address_answers).to.be.an(Array);
+
+                const stats = selector.stats();
+                expect(stats.length).to.be(2);
+                const answered = stats.filter((upstream) => upstream.latency !== null);
+                expect(answered.length).to.be.above(0);
+                expect(stats.reduce((wins, upstream) => wins + upstream.wins, 0)).to.be(2);
+                expect(selector.destroy()).to.be(true);
+                done();
+            })
+            .catch(done);
+    });
+
+    it("Should race lookups with a callback", function(done) {
+        const selector = new getdns.UpstreamSelector([
+            "8.8.8.8",
+            "8.8.4.4",
+        ], {
+            hedge: true,
+            minHedgeDelay: 1,
+            maxHedgeDelay: 1,
+        });
+
+        selector.general("getdnsapi.net", getdns.RRTYPE_A, {}, (err, result) => {
+            expect(err).to.be(null);
+            expect(result.replies_tree).to.be.an(Array);
+            const stats = selector.stats();
+            expect(stats.reduce((hedges, upstream) => hedges + upstream.hedges, 0)).to.be.within(0, 1);
+            selector.destroy();
+            done();
+        });
+    });
+
+    it("Should give upstreams their own rate limits", function() {
+        const selector = new getdns.UpstreamSelector([
+            {
+                upstream: "8.8.8.8",
+                rate_limit: {
+                    rate: 50,
+                },
+            },
+            {
+                upstream: ["8.8.4.4", 53],
+                rate_limit: null,
+            },
+            "9.9.9.9",
+        ], {
+            rate_limit: {
+                rate: 10,
+            },
+        });
+
+        const limits = selector.upstreams.map((state) => state.context.schedulerStats());
+        expect(limits[0].rateLimit.rate).to.be(50);
+        expect(limits[1]).to.be(null);
+        expect(limits[2].rateLimit.rate).to.be(10);
+        expect(selector.stats().map((stats) => stats.upstream)).to.eql(["8.8.8.8", ["8.8.4.4", 53], "9.9.9.9"]);
+        selector.destroy();
+    });
+});
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const shared = require("./shared");
+
+shared.initialize();
+
+describe("Warmup", () => {
+    it("Should warm up the upstreams", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            upstream_recursive_servers: [
+                "8.8.8.8",
+                "8.8.4.4",
+            ],
+            idle_timeout: 10000,
+        });
+
+        ctx.warmup()
+            .then((result) => {
+                expect(result.queries).to.be(2);
+                expect(result.succeeded).to.be.above(0);
+                expect(result.failed).to.be(result.queries - result.succeeded);
+                expect(result.elapsed).to.be.a("number");
+                expect(result.upstreams).to.be(2);
+                // round robin for the warmup, without the option set
+                expect(result.reached).to.be(result.succeeded);
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+
+    it("Should keep round_robin_upstreams set during a warmup", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            upstream_recursive_servers: [
+                "8.8.8.8",
+                "8.8.4.4",
+            ],
+            idle_timeout: 10000,
+        });
+        const upstreamOf = (name) => new Promise((resolve, reject) => {
+            ctx.address(name, {
+                return_call_reporting: true,
+            }, (err, result) => {
+                if (err) {
+                    return reject(err);
+                }
+                resolve(JSON.stringify(result.call_reporting[0].query_to));
+            });
+        });
+
+        const warmup = ctx.warmup();
+        ctx.round_robin_upstreams = 1;
+        warmup
+            .then(() => upstreamOf("getdnsapi.net"))
+            .then((first) => upstreamOf("verisign.com")
+                .then((second) => {
+                    // still in turn after the warmup finished
+                    expect(second).not.to.be(first);
+                    shared.destroyContext(ctx, done);
+                }))
+            .catch(done);
+    });
+
+    it("Should warm up with a callback and options", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+        });
+
+        ctx.warmup({
+            name: "getdnsapi.net",
+            type: getdns.RRTYPE_A,
+            queries: 3,
+        }, (err, result) => {
+            expect(err).to.be(null);
+            expect(result.queries).to.be(3);
+            shared.destroyContext(ctx, done);
+        });
+    });
+
+    it("Should warm up at creation", function(done) {
+        const ctx = getdns.createContext({
+            resolution_type: getdns.RESOLUTION_STUB,
+            warmup: true,
+        });
+
+        ctx.ready
+            .then((result) => {
+                expect(result.succeeded).to.be.above(0);
+                shared.destroyContext(ctx, done);
+            })
+            .catch(done);
+    });
+});
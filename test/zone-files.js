@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2014, 2015, 2016, 2017, 2018, Verisign, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the names of the copyright holders nor the
+ *   names of its contributors may be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Verisign, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* global
+after:false,
+before:false,
+describe:false,
+it:false,
+*/
+
+"use strict";
+
+const expect = require("expect.js");
+const getdns = require("../");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const shared = require("./shared");
+
+shared.initialize();
+
+const ROOT_HINTS = [
+    ".                        3600000      NS    A.ROOT-SERVERS.NET.",
+    "A.ROOT-SERVERS.NET.      3600000      A     198.41.0.4",
+    "",
+].join("\n");
+
+describe("Zone files", () => {
+    const file = path.join(os.tmpdir(), "getdns-node-root-hints-" + process.pid);
+
+    before(() => fs.writeFileSync(file, ROOT_HINTS));
+    after(() => fs.unlinkSync(file));
+
+    it("Should share root hints between contexts", function(done) {
+        const first = getdns.createContext({
+            dns_root_server: file,
+        });
+        const second = getdns.createContext({
+            dns_root_server: file,
+        });
+        shared.destroyContext(first, () => shared.destroyContext(second, done));
+    });
+
+    it("Should reload a file", function() {
+        expect(getdns.reloadZoneFiles(file)).to.be(1);
+        expect(getdns.reloadZoneFiles()).to.be.above(0);
+    });
+
+    it("Should fail to reload a missing file", function() {
+        expect(() => getdns.reloadZoneFiles(file + ".missing")).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+        });
+    });
+
+    it("Should fail to set a missing file", function() {
+        expect(() => getdns.createContext({
+            trustanchor: file + ".missing",
+        })).to.throwException((err) => {
+            expect(err).to.be.a(TypeError);
+            expect(err.code).to.be(getdns.RETURN_GENERIC_ERROR);
+        });
+    });
+});